@@ -2,15 +2,25 @@
 
 #include <array>
 #include <bitset>
+#include <cstdint>
+#include <type_traits>
 
 using std::array;
 using std::bitset;
 
+// Word width in bits: 8, 16 or 32, addresses are words too
+#ifndef CPP_PROC_WORD_SIZE
+	#define CPP_PROC_WORD_SIZE 8
+#endif
+
 namespace Architecture {
-	const size_t WORD_SIZE        = 8;
+	const size_t WORD_SIZE        = CPP_PROC_WORD_SIZE;
 	const size_t CONTROL_BUS_SIZE = 2;
 	const size_t ADDR_BUS_SIZE    = WORD_SIZE;
 	const size_t DATA_BUS_SIZE    = WORD_SIZE;
+	const size_t WORD_BYTES       = (WORD_SIZE + 7) / 8; // word size in binary files
+	
+	static_assert((WORD_SIZE == 8) || (WORD_SIZE == 16) || (WORD_SIZE == 32), "word size is 8, 16 or 32 bits");
 	
 	static constexpr size_t SERVICE_REGISTERS = 8;
 	static constexpr size_t MIN_MEMORY_SIZE   = SERVICE_REGISTERS;
@@ -18,6 +28,13 @@ namespace Architecture {
 	using Flag = bitset<1>;
 	using Word = bitset<WORD_SIZE>;
 	
+	// Smallest unsigned integer holding a word, used by word-level engines
+	using NativeWord =
+		std::conditional_t<(WORD_SIZE <= 8),  uint8_t,
+		std::conditional_t<(WORD_SIZE <= 16), uint16_t, uint32_t>>;
+	
+	const uint32_t WORD_MASK = static_cast<uint32_t>((uint64_t(1) << WORD_SIZE) - 1);
+	
 	template<size_t Size>
 	using WordSet = array<Word, Size>;
 }
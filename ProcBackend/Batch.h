@@ -0,0 +1,835 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#if !defined(CPP_PROC_NO_SIMD) && defined(__AVX2__)
+	#define CPP_PROC_BATCH_AVX2
+	#include <immintrin.h>
+#elif !defined(CPP_PROC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+	#define CPP_PROC_BATCH_SSE2
+	#include <emmintrin.h>
+#endif
+
+#include "Image.h"
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::vector;
+
+using Images::Image;
+using Logics::WordTick;
+using Logics::WordRunner;
+using Architecture::NativeWord;
+using Architecture::WORD_MASK;
+using Architecture::WORD_SIZE;
+using Architecture::SERVICE_REGISTERS;
+
+namespace Batch {
+	// Vector operations over words, masks are words with all bits set or zero.
+	// Every engine provides the same set, RowOps is written once against it.
+	class ScalarOps {
+	public:
+		using Type = NativeWord;
+		static constexpr size_t Lanes = 1;
+
+		static Type load(const NativeWord* p)         { return *p; }
+		static void store(NativeWord* p, Type v)      { *p = v; }
+		static Type set1(NativeWord v)                { return v; }
+		static Type ones()                            { return NativeWord(~NativeWord(0)); }
+		static Type and_(Type a, Type b)              { return a & b; }
+		static Type or_(Type a, Type b)               { return a | b; }
+		static Type andnot(Type a, Type b)            { return a & NativeWord(~b); } // a & ~b
+		static Type add(Type a, Type b)               { return NativeWord((uint32_t(a) + b) & WORD_MASK); }
+		static Type sub(Type a, Type b)               { return NativeWord((uint32_t(a) - b) & WORD_MASK); }
+		static Type max(Type a, Type b)               { return std::max(a, b); }
+		static Type eq(Type a, Type b)                { return (a == b) ? ones() : 0; }
+		static Type blend(Type a, Type b, Type mask)  { return (b & mask) | (a & NativeWord(~mask)); }
+		static bool any(Type v)                       { return v != 0; }
+	};
+
+#if defined(CPP_PROC_BATCH_AVX2)
+	class Avx2Ops {
+	public:
+		using Type = __m256i;
+		static constexpr size_t Lanes = 32;
+
+		static Type load(const uint8_t* p)            { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+		static void store(uint8_t* p, Type v)         { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+		static Type set1(uint8_t v)                   { return _mm256_set1_epi8(static_cast<char>(v)); }
+		static Type ones()                            { return _mm256_set1_epi8(-1); }
+		static Type and_(Type a, Type b)              { return _mm256_and_si256(a, b); }
+		static Type or_(Type a, Type b)               { return _mm256_or_si256(a, b); }
+		static Type andnot(Type a, Type b)            { return _mm256_andnot_si256(b, a); }
+		static Type add(Type a, Type b)               { return _mm256_add_epi8(a, b); }
+		static Type sub(Type a, Type b)               { return _mm256_sub_epi8(a, b); }
+		static Type max(Type a, Type b)               { return _mm256_max_epu8(a, b); }
+		static Type eq(Type a, Type b)                { return _mm256_cmpeq_epi8(a, b); }
+		static Type blend(Type a, Type b, Type mask)  { return _mm256_blendv_epi8(a, b, mask); }
+		static bool any(Type v)                       { return !_mm256_testz_si256(v, v); }
+	};
+#endif
+
+#if defined(CPP_PROC_BATCH_SSE2)
+	class Sse2Ops {
+	public:
+		using Type = __m128i;
+		static constexpr size_t Lanes = 16;
+
+		static Type load(const uint8_t* p)            { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static void store(uint8_t* p, Type v)         { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+		static Type set1(uint8_t v)                   { return _mm_set1_epi8(static_cast<char>(v)); }
+		static Type ones()                            { return _mm_set1_epi8(-1); }
+		static Type and_(Type a, Type b)              { return _mm_and_si128(a, b); }
+		static Type or_(Type a, Type b)               { return _mm_or_si128(a, b); }
+		static Type andnot(Type a, Type b)            { return _mm_andnot_si128(b, a); }
+		static Type add(Type a, Type b)               { return _mm_add_epi8(a, b); }
+		static Type sub(Type a, Type b)               { return _mm_sub_epi8(a, b); }
+		static Type max(Type a, Type b)               { return _mm_max_epu8(a, b); }
+		static Type eq(Type a, Type b)                { return _mm_cmpeq_epi8(a, b); }
+		static Type blend(Type a, Type b, Type mask)  { return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a)); }
+		static bool any(Type v)                       { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF; }
+	};
+#endif
+
+	// Vector instructions only pay off when a word is a byte
+#if defined(CPP_PROC_BATCH_AVX2)
+	using SimdOps = std::conditional_t<(WORD_SIZE == 8), Avx2Ops, ScalarOps>;
+#elif defined(CPP_PROC_BATCH_SSE2)
+	using SimdOps = std::conditional_t<(WORD_SIZE == 8), Sse2Ops, ScalarOps>;
+#else
+	using SimdOps = ScalarOps;
+#endif
+
+	// Lane count is padded to this, so rows never have a tail
+	const size_t LANE_ALIGN = 32;
+
+	// Masked operations over rows (one word of every lane), n is a multiple of V::Lanes.
+	// Only lanes with mask set are changed, carry/borrow/out rows are written for all lanes.
+	template<class V>
+	class RowOps {
+		using W = NativeWord;
+	public:
+		static void fill(W* dst, W value, size_t n) {
+			auto v = V::set1(value);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(dst + i, v);
+			}
+		}
+
+		static void blend(W* dst, const W* src, const W* mask, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(dst + i, V::blend(V::load(dst + i), V::load(src + i), V::load(mask + i)));
+			}
+		}
+
+		static void blend_value(W* dst, W value, const W* mask, size_t n) {
+			auto v = V::set1(value);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(dst + i, V::blend(V::load(dst + i), v, V::load(mask + i)));
+			}
+		}
+
+		// dst |= bits
+		static void set_bits(W* dst, W bits, const W* mask, size_t n) {
+			auto b = V::set1(bits);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(dst + i, V::or_(V::load(dst + i), V::and_(b, V::load(mask + i))));
+			}
+		}
+
+		// dst &= ~bits
+		static void clear_bits(W* dst, W bits, const W* mask, size_t n) {
+			auto b = V::set1(bits);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(dst + i, V::andnot(V::load(dst + i), V::and_(b, V::load(mask + i))));
+			}
+		}
+
+		// dst bits = cond ? bits : 0
+		static void assign_bits(W* dst, W bits, const W* cond, const W* mask, size_t n) {
+			auto b = V::set1(bits);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				auto selected = V::and_(b, V::load(mask + i));
+				auto value = V::and_(selected, V::load(cond + i));
+				V::store(dst + i, V::or_(V::andnot(V::load(dst + i), selected), value));
+			}
+		}
+
+		// out = (src & bits) != 0
+		static void test_bits(W* out, const W* src, W bits, size_t n) {
+			auto b = V::set1(bits);
+			auto zero = V::set1(0);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(out + i, V::andnot(V::ones(), V::eq(V::and_(V::load(src + i), b), zero)));
+			}
+		}
+
+		// mask &= (row & bits) == value
+		static void match(W* mask, const W* row, W bits, W value, size_t n) {
+			auto b = V::set1(bits);
+			auto v = V::set1(value);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(mask + i, V::and_(V::load(mask + i), V::eq(V::and_(V::load(row + i), b), v)));
+			}
+		}
+
+		static void add(W* dst, const W* a, const W* b, W* carry, const W* mask, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				add_vector(dst + i, V::load(a + i), V::load(b + i), carry + i, mask + i);
+			}
+		}
+
+		static void add_value(W* dst, const W* a, W value, W* carry, const W* mask, size_t n) {
+			auto v = V::set1(value);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				add_vector(dst + i, V::load(a + i), v, carry + i, mask + i);
+			}
+		}
+
+		static void sub(W* dst, const W* a, const W* b, W* borrow, const W* mask, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				sub_vector(dst + i, V::load(a + i), V::load(b + i), borrow + i, mask + i);
+			}
+		}
+
+		static void sub_value(W* dst, const W* a, W value, W* borrow, const W* mask, size_t n) {
+			auto v = V::set1(value);
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				sub_vector(dst + i, V::load(a + i), v, borrow + i, mask + i);
+			}
+		}
+
+		static void equal(W* out, const W* a, const W* b, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(out + i, V::eq(V::load(a + i), V::load(b + i)));
+			}
+		}
+
+		static void and_rows(W* out, const W* a, const W* b, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(out + i, V::and_(V::load(a + i), V::load(b + i)));
+			}
+		}
+
+		// out = a & ~b
+		static void andnot_rows(W* out, const W* a, const W* b, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				V::store(out + i, V::andnot(V::load(a + i), V::load(b + i)));
+			}
+		}
+
+		static bool any(const W* mask, size_t n) {
+			for (size_t i = 0; i < n; i += V::Lanes) {
+				if (V::any(V::load(mask + i))) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		// Wrapped sum is less than the operand exactly on carry
+		static void add_vector(W* dst, typename V::Type a, typename V::Type b, W* carry, const W* mask) {
+			auto sum = V::add(a, b);
+			V::store(carry, V::andnot(V::ones(), V::eq(V::max(sum, a), sum)));
+			V::store(dst, V::blend(V::load(dst), sum, V::load(mask)));
+		}
+
+		static void sub_vector(W* dst, typename V::Type a, typename V::Type b, W* borrow, const W* mask) {
+			auto diff = V::sub(a, b);
+			V::store(borrow, V::andnot(V::ones(), V::eq(V::max(a, b), a)));
+			V::store(dst, V::blend(V::load(dst), diff, V::load(mask)));
+		}
+	};
+
+	using Rows = RowOps<SimdOps>;
+
+	enum class LaneStatus {
+		Running,    // tick limit is not reached yet
+		Terminated, // terminated without Fatal flag
+		Fatal,      // terminated with Fatal flag
+		Invalid,    // command used common register out of range
+	};
+
+	// Runs N machines in lock step, state is kept as structure of arrays:
+	// every CPU word, RAM word and bus is a row with one word per lane.
+	// Each tick lanes are grouped by pipeline step and decoded instruction,
+	// so inside a group code and arguments are scalars and every step is a few
+	// masked row operations (AVX2/SSE2 when words are bytes, scalar otherwise).
+	// Same-image sweeps stay in one group; lanes which diverge (JZ, different data)
+	// form more groups, beyond MAX_GROUPS the rest is ticked lane by lane with WordRunner.
+	// RAM access is a gather/scatter and is done lane by lane.
+	// Results are the same as ticking every Computer separately until tick() returns false.
+	template<size_t IMS, size_t RMS>
+	class BatchComputer {
+		using W = NativeWord;
+
+		static const size_t MAX_GROUPS = 8;
+
+		class Lane {
+		public:
+			Lane(BatchComputer& batch, size_t lane): _batch(batch), _lane(lane) { }
+
+			W& cpu(size_t index)     { return _batch._cpu[index * _batch._stride + _lane]; }
+			W& ram(size_t address)   { return _batch._ram[address * _batch._stride + _lane]; }
+			W& control()             { return _batch._control[_lane]; }
+			W& address()             { return _batch._address[_lane]; }
+			W& data()                { return _batch._data[_lane]; }
+			size_t cpu_size() const  { return IMS; }
+			size_t ram_size() const  { return RMS; }
+
+		private:
+			BatchComputer& _batch;
+			size_t         _lane;
+		};
+
+		class Key {
+		public:
+			W Step = 0;
+			W Code = 0; // data bus at Decode, argument mode at Read_1, command code at Execute
+			W X    = 0;
+			W Y    = 0;
+		};
+
+	public:
+		BatchComputer(size_t lanes):
+			_lanes(lanes), _stride((lanes + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN),
+			_cpu(IMS * _stride, 0), _ram(RMS * _stride, 0),
+			_control(_stride, 0), _address(_stride, 0), _data(_stride, 0),
+			_running(_stride, 0), _pending(_stride, 0), _group(_stride, 0),
+			_carry(_stride, 0), _cond(_stride, 0), _selected(_stride, 0), _rest(_stride, 0),
+			_status(lanes, LaneStatus::Running), _ticks(lanes, 0) {
+			for (size_t i = 0; i < lanes; i++) {
+				_running[i] = ScalarOps::ones();
+			}
+		}
+
+		size_t get_lanes() const {
+			return _lanes;
+		}
+
+		// Same state as Computer built from image.Ram with image applied
+		void load(size_t lane, const Image<IMS, RMS>& image) {
+			for (size_t i = 0; i < IMS; i++) {
+				_cpu[i * _stride + lane] = W(image.Registers[i].to_ulong());
+			}
+			if (image.EntryIP != 0) {
+				_cpu[Logics::WordLayout::IP * _stride + lane] = W(image.EntryIP & WORD_MASK);
+			}
+			for (size_t i = 0; i < RMS; i++) {
+				_ram[i * _stride + lane] = W(image.Ram[i].to_ulong());
+			}
+			_control[lane] = 0;
+			_address[lane] = 0;
+			_data[lane]    = 0;
+			_running[lane] = ScalarOps::ones();
+			_status[lane]  = LaneStatus::Running;
+			_ticks[lane]   = 0;
+		}
+
+		// Scalar mode ticks every lane with WordRunner, used as reference
+		void set_vectorized(bool value) {
+			_vectorized = value;
+		}
+
+		// One tick of all running lanes, returns true while any lane is running
+		bool tick() {
+			if (!Rows::any(_running.data(), _stride)) {
+				return false;
+			}
+			_tick++;
+			if (_vectorized) {
+				tick_ram();
+				tick_cpu();
+			} else {
+				for (size_t i = 0; i < _lanes; i++) {
+					if (_running[i]) {
+						auto lane = Lane(*this, i);
+						update_lane(i, WordRunner<Lane>(lane).tick());
+					}
+				}
+			}
+			return Rows::any(_running.data(), _stride);
+		}
+
+		// Ticks until every lane stops or tick limit (0 - unlimited), returns done ticks
+		size_t run(size_t max_ticks = 0) {
+			auto start = _tick;
+			while (((max_ticks == 0) || (_tick - start < max_ticks)) && tick()) {
+			}
+			return _tick - start;
+		}
+
+		LaneStatus get_status(size_t lane) const {
+			return _status[lane];
+		}
+
+		// Ticks done by the lane, including the one which stopped it
+		size_t get_ticks(size_t lane) const {
+			return (_status[lane] == LaneStatus::Running) ? _tick : _ticks[lane];
+		}
+
+		// Ticks when lanes of one step were split into several groups
+		size_t get_divergent_ticks() const {
+			return _divergent_ticks;
+		}
+
+		W get_cpu(size_t lane, size_t index) const   { return _cpu[index * _stride + lane]; }
+		W get_ram(size_t lane, size_t address) const { return _ram[address * _stride + lane]; }
+		W get_control(size_t lane) const             { return _control[lane]; }
+		W get_address(size_t lane) const             { return _address[lane]; }
+		W get_data(size_t lane) const                { return _data[lane]; }
+
+	private:
+		const size_t _lanes;
+		const size_t _stride;
+		vector<W>    _cpu;
+		vector<W>    _ram;
+		vector<W>    _control;
+		vector<W>    _address;
+		vector<W>    _data;
+		vector<W>    _running;
+		vector<W>    _pending;  // running lanes without group in current tick
+		vector<W>    _group;    // lanes of current group
+		vector<W>    _carry;
+		vector<W>    _cond;
+		vector<W>    _selected;
+		vector<W>    _rest;
+
+		vector<LaneStatus> _status;
+		vector<size_t>     _ticks;
+		size_t             _tick            = 0;
+		size_t             _divergent_ticks = 0;
+		bool               _vectorized      = true;
+
+		W* row(size_t index) {
+			return &_cpu[index * _stride];
+		}
+
+		W* cn(W index) {
+			return row(SERVICE_REGISTERS + index);
+		}
+
+		bool is_valid(W index) const {
+			return index < IMS - SERVICE_REGISTERS;
+		}
+
+		void update_lane(size_t lane, WordTick result) {
+			if (result == WordTick::Running) {
+				return;
+			}
+			auto fatal = (_cpu[Logics::WordLayout::FS * _stride + lane] & Logics::WordLayout::FT_BIT) != 0;
+			_status[lane]  = (result == WordTick::Invalid) ? LaneStatus::Invalid : (fatal ? LaneStatus::Fatal : LaneStatus::Terminated);
+			_ticks[lane]   = _tick;
+			_running[lane] = 0;
+		}
+
+		void tick_ram() {
+			for (size_t i = 0; i < _lanes; i++) {
+				if (_running[i] && (_control[i] & Logics::WordLayout::BUS_ENABLED)) {
+					auto lane = Lane(*this, i);
+					WordRunner<Lane>(lane).tick_ram();
+				}
+			}
+		}
+
+		// Lanes which have Terminated flag are stopped
+		void stop_terminated() {
+			Rows::test_bits(_cond.data(), row(Logics::WordLayout::FS), Logics::WordLayout::TR_BIT, _stride);
+			Rows::and_rows(_cond.data(), _cond.data(), _running.data(), _stride);
+			if (!Rows::any(_cond.data(), _stride)) {
+				return;
+			}
+			for (size_t i = 0; i < _lanes; i++) {
+				if (_cond[i]) {
+					update_lane(i, WordTick::Stopped);
+				}
+			}
+		}
+
+		void tick_cpu() {
+			using namespace Logics::WordLayout;
+			Rows::clear_bits(_control.data(), BUS_ENABLED | BUS_WRITE, _running.data(), _stride);
+			stop_terminated();
+
+			_pending = _running;
+			size_t groups = 0;
+			size_t first = 0;
+			while (find_pending(first)) {
+				if (groups == MAX_GROUPS) {
+					tick_lanes(first);
+					break;
+				}
+				auto key = make_key(first);
+				make_group(key);
+				run_group(key);
+				groups++;
+			}
+			if (groups > 1) {
+				_divergent_ticks++;
+			}
+			stop_terminated();
+		}
+
+		bool find_pending(size_t& first) {
+			for (; first < _lanes; first++) {
+				if (_pending[first]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Rest of pending lanes is ticked one by one
+		void tick_lanes(size_t first) {
+			for (size_t i = first; i < _lanes; i++) {
+				if (_pending[i]) {
+					auto lane = Lane(*this, i);
+					update_lane(i, WordRunner<Lane>(lane).tick_cpu());
+				}
+			}
+		}
+
+		Key make_key(size_t lane) {
+			using namespace Logics::WordLayout;
+			Key key;
+			key.Step = _cpu[SS * _stride + lane] & PS_MASK;
+			switch (key.Step) {
+				case Logics::Tick::Decode:
+					key.Code = _data[lane];
+					break;
+				case Logics::Tick::Read_1:
+					key.Code = _cpu[SS * _stride + lane] & AM_BIT;
+					break;
+				case Logics::Tick::Execute_1:
+				case Logics::Tick::Execute_2:
+					key.Code = _cpu[CC * _stride + lane];
+					key.X    = _cpu[A1 * _stride + lane];
+					key.Y    = _cpu[A2 * _stride + lane];
+					break;
+			}
+			return key;
+		}
+
+		// Pending lanes with the same key form the group and leave pending
+		void make_group(const Key& key) {
+			using namespace Logics::WordLayout;
+			auto group = _group.data();
+			std::copy(_pending.begin(), _pending.end(), _group.begin());
+			Rows::match(group, row(SS), PS_MASK, key.Step, _stride);
+			switch (key.Step) {
+				case Logics::Tick::Decode:
+					Rows::match(group, _data.data(), W(~W(0)), key.Code, _stride);
+					break;
+				case Logics::Tick::Read_1:
+					Rows::match(group, row(SS), AM_BIT, key.Code, _stride);
+					break;
+				case Logics::Tick::Execute_1:
+				case Logics::Tick::Execute_2:
+					Rows::match(group, row(CC), W(~W(0)), key.Code, _stride);
+					Rows::match(group, row(A1), W(~W(0)), key.X, _stride);
+					Rows::match(group, row(A2), W(~W(0)), key.Y, _stride);
+					break;
+			}
+			Rows::andnot_rows(_pending.data(), _pending.data(), group, _stride);
+		}
+
+		void run_group(const Key& key) {
+			using namespace Logics::WordLayout;
+			auto group = _group.data();
+			switch (key.Step) {
+				case Logics::Tick::Fetch:
+					request_read(row(IP), group);
+					inc_step(key.Step, group);
+					break;
+
+				case Logics::Tick::Decode: {
+					Rows::blend_value(row(CC), key.Code, group, _stride);
+					auto args = get_arguments(key.Code);
+					if (args < 0) {
+						raise_fatal(group);
+					} else if (args == 0) {
+						set_step(Logics::Tick::Execute_1, group);
+					} else {
+						set_step(Logics::Tick::Read_1, group);
+						if (args > 1) {
+							Rows::set_bits(row(SS), AM_BIT, group, _stride);
+						} else {
+							Rows::clear_bits(row(SS), AM_BIT, group, _stride);
+						}
+						request_read_next(1, group);
+					}
+					break;
+				}
+
+				case Logics::Tick::Read_1:
+					Rows::blend(row(A1), _data.data(), group, _stride);
+					if (key.Code) {
+						set_step(Logics::Tick::Read_2, group);
+						request_read_next(2, group);
+					} else {
+						set_step(Logics::Tick::Execute_1, group);
+					}
+					break;
+
+				case Logics::Tick::Read_2:
+					Rows::blend(row(A2), _data.data(), group, _stride);
+					inc_step(key.Step, group);
+					break;
+
+				case Logics::Tick::Execute_1:
+				case Logics::Tick::Execute_2:
+					run_execute(key, group);
+					break;
+
+				default:
+					raise_fatal(group);
+			}
+		}
+
+		void run_execute(const Key& key, const W* group) {
+			using namespace Logics::WordLayout;
+			if (get_arguments(key.Code) < 0) {
+				raise_fatal(group);
+				return;
+			}
+			auto first = (key.Step == Logics::Tick::Execute_1);
+			auto done = true;
+			if (!execute(key, first ? 0 : 1, group, done)) {
+				for (size_t i = 0; i < _lanes; i++) {
+					if (group[i]) {
+						update_lane(i, WordTick::Invalid);
+					}
+				}
+				return;
+			}
+			Rows::test_bits(_cond.data(), row(FS), TR_BIT, _stride);
+			Rows::and_rows(_selected.data(), _cond.data(), group, _stride);
+			raise_fatal(_selected.data());
+			Rows::andnot_rows(_rest.data(), group, _cond.data(), _stride);
+			if (first && !done) {
+				inc_step(key.Step, _rest.data());
+			} else {
+				finish_steps(_rest.data());
+			}
+		}
+
+		void set_step(W step, const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::clear_bits(row(SS), PS_MASK, mask, _stride);
+			Rows::set_bits(row(SS), step, mask, _stride);
+		}
+
+		// Group has one step, so the 3-bit increment overflows only from the last one
+		void inc_step(W step, const W* mask) {
+			using namespace Logics::WordLayout;
+			set_step((step + 1) & PS_MASK, mask);
+			if (step == PS_MASK) {
+				Rows::set_bits(row(FS), OF_BIT, mask, _stride);
+			} else {
+				Rows::clear_bits(row(FS), OF_BIT, mask, _stride);
+			}
+		}
+
+		void finish_steps(const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::clear_bits(row(SS), PS_MASK | AM_BIT, mask, _stride);
+			Rows::blend_value(row(CC), 0, mask, _stride);
+			Rows::blend_value(row(A1), 0, mask, _stride);
+			Rows::blend_value(row(A2), 0, mask, _stride);
+		}
+
+		void raise_fatal(const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::set_bits(row(FS), FT_BIT | TR_BIT, mask, _stride);
+		}
+
+		void request_read(const W* address, const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::clear_bits(_control.data(), BUS_WRITE, mask, _stride);
+			Rows::set_bits(_control.data(), BUS_ENABLED, mask, _stride);
+			Rows::blend(_address.data(), address, mask, _stride);
+			Rows::blend_value(_data.data(), 0, mask, _stride);
+		}
+
+		// Argument read at IP + offset, address wraps like the address bus
+		void request_read_next(W offset, const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::clear_bits(_control.data(), BUS_WRITE, mask, _stride);
+			Rows::set_bits(_control.data(), BUS_ENABLED, mask, _stride);
+			Rows::add_value(_address.data(), row(IP), offset, _carry.data(), mask, _stride);
+			Rows::blend_value(_data.data(), 0, mask, _stride);
+		}
+
+		void request_write(const W* address, const W* value, const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::set_bits(_control.data(), BUS_ENABLED | BUS_WRITE, mask, _stride);
+			Rows::blend(_address.data(), address, mask, _stride);
+			Rows::blend(_data.data(), value, mask, _stride);
+		}
+
+		// Overflow flag takes carry of the last operation
+		void set_overflow(const W* mask) {
+			using namespace Logics::WordLayout;
+			Rows::assign_bits(row(FS), OF_BIT, _carry.data(), mask, _stride);
+		}
+
+		void add_value(size_t index, W value, const W* mask) {
+			Rows::add_value(row(index), row(index), value, _carry.data(), mask, _stride);
+			set_overflow(mask);
+		}
+
+		void sub_value(size_t index, W value, const W* mask) {
+			Rows::sub_value(row(index), row(index), value, _carry.data(), mask, _stride);
+			set_overflow(mask);
+		}
+
+		void sub_row(size_t index, const W* value, const W* mask) {
+			Rows::sub(row(index), row(index), value, _carry.data(), mask, _stride);
+			set_overflow(mask);
+		}
+
+		void set_next_op(size_t args, const W* mask) {
+			using namespace Logics::WordLayout;
+			add_value(CR, 1, mask);
+			add_value(IP, W(1 + args), mask);
+			Rows::and_rows(_carry.data(), _carry.data(), mask, _stride);
+			raise_fatal(_carry.data());
+		}
+
+		void jump(W address, const W* mask) {
+			using namespace Logics::WordLayout;
+			add_value(CR, 1, mask);
+			Rows::blend_value(row(IP), address, mask, _stride);
+		}
+
+		// Same as WordRunner::execute for all lanes of the group,
+		// returns false when common register index is out of range
+		bool execute(const Key& key, int step, const W* group, bool& done) {
+			using namespace Logics::WordLayout;
+			using Logics::Command;
+			auto x = key.X;
+			auto y = key.Y;
+			auto valid_x = is_valid(x);
+			auto valid_xy = valid_x && is_valid(y);
+
+			switch (key.Code) {
+				case Command::NOOP:
+					set_next_op(0, group);
+					break;
+				case Command::RST:
+					Rows::set_bits(row(FS), TR_BIT, group, _stride);
+					set_next_op(0, group);
+					break;
+				case Command::CLR:
+					if (!valid_x) return false;
+					Rows::blend_value(cn(x), 0, group, _stride);
+					set_next_op(1, group);
+					break;
+				case Command::INC:
+					if (!valid_x) return false;
+					add_value(SERVICE_REGISTERS + x, 1, group);
+					set_next_op(1, group);
+					break;
+				case Command::SUM:
+					if (!valid_xy) return false;
+					Rows::add(row(AR), cn(x), cn(y), _carry.data(), group, _stride);
+					set_overflow(group);
+					set_next_op(2, group);
+					break;
+				case Command::MOV:
+					if (!valid_xy) return false;
+					Rows::blend(cn(y), cn(x), group, _stride);
+					set_next_op(2, group);
+					break;
+				case Command::CLRA:
+					Rows::blend_value(row(AR), 0, group, _stride);
+					set_next_op(0, group);
+					break;
+				case Command::INCA:
+					add_value(AR, 1, group);
+					set_next_op(0, group);
+					break;
+				case Command::ADDA:
+					add_value(AR, x, group);
+					set_next_op(1, group);
+					break;
+				case Command::LD:
+					if (step == 0) {
+						if (!valid_x) return false;
+						request_read(cn(x), group);
+						done = false;
+					} else {
+						if (!is_valid(y)) return false;
+						Rows::blend(cn(y), _data.data(), group, _stride);
+						set_next_op(2, group);
+					}
+					break;
+				case Command::ST:
+					if (!valid_xy) return false;
+					request_write(cn(y), cn(x), group);
+					set_next_op(2, group);
+					break;
+				case Command::SUB:
+					if (!valid_xy) return false;
+					sub_row(SERVICE_REGISTERS + x, cn(y), group);
+					set_next_op(2, group);
+					break;
+				case Command::SUBA:
+					if (!valid_x) return false;
+					sub_row(AR, cn(x), group);
+					set_next_op(1, group);
+					break;
+				case Command::DEC:
+					if (!valid_x) return false;
+					sub_value(SERVICE_REGISTERS + x, 1, group);
+					set_next_op(1, group);
+					break;
+				case Command::DECA:
+					sub_value(AR, 1, group);
+					set_next_op(0, group);
+					break;
+				case Command::JMP:
+					jump(x, group);
+					break;
+				case Command::LDA:
+					if (step == 0) {
+						if (!valid_x) return false;
+						request_read(cn(x), group);
+						done = false;
+					} else {
+						Rows::blend(row(AR), _data.data(), group, _stride);
+						set_next_op(1, group);
+					}
+					break;
+				case Command::STA:
+					if (!valid_x) return false;
+					request_write(cn(x), row(AR), group);
+					set_next_op(1, group);
+					break;
+				case Command::CMP:
+					if (!valid_xy) return false;
+					Rows::equal(_cond.data(), cn(x), cn(y), _stride);
+					Rows::assign_bits(row(FS), ZF_BIT, _cond.data(), group, _stride);
+					set_next_op(2, group);
+					break;
+				case Command::JZ:
+					// Lanes diverge here: taken lanes jump, others go on, both under own mask
+					Rows::test_bits(_cond.data(), row(FS), ZF_BIT, _stride);
+					Rows::and_rows(_selected.data(), _cond.data(), group, _stride);
+					Rows::andnot_rows(_rest.data(), group, _cond.data(), _stride);
+					jump(x, _selected.data());
+					set_next_op(1, _rest.data());
+					break;
+				case Command::SET:
+					if (!is_valid(y)) return false;
+					Rows::blend_value(cn(y), x, group, _stride);
+					set_next_op(2, group);
+					break;
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <cstdint>
+#include <algorithm>
+
+#include "BitUtils.h"
+
+using std::array;
+using std::tuple;
+
+namespace BitSlice {
+	// Bit k of a lanes word belongs to k-th of 64 independent operations,
+	// an operand of width W is W planes, plane i holds bit i of every lane.
+	using Lanes = uint64_t;
+
+	const size_t LANE_COUNT = 64;
+	const size_t LANE_BITS  = 6; // bits of lane index
+	const size_t MAX_WIDTH  = 16;
+
+	using Planes = array<Lanes, MAX_WIDTH>;
+
+	// Planes of lane index: bit i of lane l is bit i of l
+	const Lanes COUNTER[LANE_BITS] = {
+		0xAAAAAAAAAAAAAAAAULL,
+		0xCCCCCCCCCCCCCCCCULL,
+		0xF0F0F0F0F0F0F0F0ULL,
+		0xFF00FF00FF00FF00ULL,
+		0xFFFF0000FFFF0000ULL,
+		0xFFFFFFFF00000000ULL,
+	};
+
+	enum class Operation {
+		Plus,
+		Minus,
+		Inverse,
+	};
+
+	const char* to_string(Operation operation) {
+		switch (operation) {
+			case Operation::Plus:    return "plus";
+			case Operation::Minus:   return "minus";
+			case Operation::Inverse: return "inverse";
+		}
+		return "unknown";
+	}
+
+	// Same ripple chains of BitUtils gates as BitUtils::plus/minus/inverse on bitsets
+	Lanes plus(const Planes& a, const Planes& b, size_t width, Planes& result) {
+		Lanes carry = 0;
+		for (size_t i = 0; i < width; i++) {
+			auto [sum, next] = BitUtils::full_adder(a[i], b[i], carry);
+			result[i] = sum;
+			carry = next;
+		}
+		return carry;
+	}
+
+	Lanes minus(const Planes& a, const Planes& b, size_t width, Planes& result) {
+		Lanes borrow = 0;
+		for (size_t i = 0; i < width; i++) {
+			auto [diff, next] = BitUtils::full_subtractor(a[i], b[i], borrow);
+			result[i] = diff;
+			borrow = next;
+		}
+		return borrow;
+	}
+
+	void inverse(const Planes& a, size_t width, Planes& result) {
+		for (size_t i = 0; i < width; i++) {
+			result[i] = BitUtils::gate_not(a[i]);
+		}
+	}
+
+	Lanes evaluate(Operation operation, const Planes& a, const Planes& b, size_t width, Planes& result) {
+		switch (operation) {
+			case Operation::Plus:  return plus(a, b, width, result);
+			case Operation::Minus: return minus(a, b, width, result);
+			default:
+				inverse(a, width, result);
+				return 0;
+		}
+	}
+
+	// Native integer result and carry/borrow flag
+	tuple<uint64_t, bool> reference(Operation operation, uint64_t a, uint64_t b, size_t width) {
+		auto mask = (uint64_t(1) << width) - 1;
+		switch (operation) {
+			case Operation::Plus:  return { (a + b) & mask, (a + b) > mask };
+			case Operation::Minus: return { (a - b) & mask, a < b };
+			default:               return { ~a & mask, false };
+		}
+	}
+
+	Lanes fill(bool bit) {
+		return bit ? ~Lanes(0) : 0;
+	}
+
+	class Report {
+	public:
+		Operation Op         = Operation::Plus;
+		size_t    Width      = 0;
+		uint64_t  Checked    = 0; // operand combinations
+		uint64_t  Mismatches = 0;
+		uint64_t  FirstA     = 0; // operands of the first mismatch
+		uint64_t  FirstB     = 0;
+
+		bool is_ok() const {
+			return Mismatches == 0;
+		}
+
+		// Lane l of mismatching lanes has operands (a_of_lane0 + l, b)
+		void add_mismatches(Lanes lanes, uint64_t a_of_lane0, uint64_t b) {
+			if (lanes == 0) {
+				return;
+			}
+			if (Mismatches == 0) {
+				size_t first = 0;
+				while (((lanes >> first) & 1) == 0) {
+					first++;
+				}
+				FirstA = a_of_lane0 + first;
+				FirstB = b;
+			}
+			for (; lanes != 0; lanes &= lanes - 1) {
+				Mismatches++;
+			}
+		}
+	};
+
+	// Every operand combination, one operation per lane, native result is transposed
+	// into planes lane by lane. Used for small widths and for inverse.
+	Report verify_by_lanes(Operation operation, size_t width) {
+		Report report;
+		report.Op = operation;
+		report.Width = width;
+		auto mask = (uint64_t(1) << width) - 1;
+		auto total = (operation == Operation::Inverse) ? (uint64_t(1) << width) : (uint64_t(1) << (2 * width));
+		for (uint64_t start = 0; start < total; start += LANE_COUNT) {
+			auto count = std::min<uint64_t>(LANE_COUNT, total - start);
+			Planes a = { }, b = { }, expected = { }, result = { };
+			Lanes expected_carry = 0;
+			for (size_t lane = 0; lane < count; lane++) {
+				auto index = start + lane;
+				auto x = index & mask;
+				auto y = index >> width;
+				auto [value, flag] = reference(operation, x, y, width);
+				for (size_t i = 0; i < width; i++) {
+					a[i]        |= Lanes((x     >> i) & 1) << lane;
+					b[i]        |= Lanes((y     >> i) & 1) << lane;
+					expected[i] |= Lanes((value >> i) & 1) << lane;
+				}
+				expected_carry |= Lanes(flag) << lane;
+			}
+			auto carry = evaluate(operation, a, b, width, result);
+			auto diff = carry ^ expected_carry;
+			for (size_t i = 0; i < width; i++) {
+				diff |= result[i] ^ expected[i];
+			}
+			auto valid = (count == LANE_COUNT) ? ~Lanes(0) : ((Lanes(1) << count) - 1);
+			diff &= valid;
+			// For small widths lanes of one word differ in b too, so lanes are reported one by one
+			for (size_t lane = 0; lane < count; lane++) {
+				auto index = start + lane;
+				report.add_mismatches(diff & (Lanes(1) << lane), (index & mask) - lane, index >> width);
+			}
+			report.Checked += count;
+		}
+		return report;
+	}
+
+	// Plus/minus for widths from LANE_BITS: lanes of one word share high bits of a and all of b,
+	// low LANE_BITS of a are the lane index. Then reference is two native operations per word:
+	// low bits of the result depend only on low bits of b (precomputed table),
+	// high bits are (a >> 6) +- (b >> 6) +- carry out of low bits, with carry 0 or 1.
+	Report verify_by_words(Operation operation, size_t width) {
+		const auto is_plus = (operation == Operation::Plus);
+		const size_t LOWS = size_t(1) << LANE_BITS;
+
+		Report report;
+		report.Op = operation;
+		report.Width = width;
+
+		array<array<Lanes, LANE_BITS>, LOWS> low_table = { };
+		array<Lanes, LOWS> carry_table = { };
+		for (size_t b_low = 0; b_low < LOWS; b_low++) {
+			for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+				auto value = is_plus ? (lane + b_low) : (lane - b_low);
+				auto carry = is_plus ? (value >= LOWS) : (lane < b_low);
+				for (size_t i = 0; i < LANE_BITS; i++) {
+					low_table[b_low][i] |= Lanes((value >> i) & 1) << lane;
+				}
+				carry_table[b_low] |= Lanes(carry) << lane;
+			}
+		}
+
+		const auto high_bits = width - LANE_BITS;
+		const auto high_mask = (int64_t(1) << high_bits) - 1;
+		Planes a = { }, b = { }, result = { };
+		for (size_t i = 0; i < LANE_BITS; i++) {
+			a[i] = COUNTER[i];
+		}
+		for (uint64_t y = 0; y < (uint64_t(1) << width); y++) {
+			for (size_t i = 0; i < width; i++) {
+				b[i] = fill((y >> i) & 1);
+			}
+			const auto& lows = low_table[y & (LOWS - 1)];
+			const auto low_carry = carry_table[y & (LOWS - 1)];
+			const auto y_high = int64_t(y >> LANE_BITS);
+			for (int64_t x_high = 0; x_high <= high_mask; x_high++) {
+				for (size_t i = 0; i < high_bits; i++) {
+					a[LANE_BITS + i] = fill((x_high >> i) & 1);
+				}
+				auto carry = evaluate(operation, a, b, width, result);
+
+				auto high_0 = is_plus ? (x_high + y_high) : (x_high - y_high);
+				auto high_1 = is_plus ? (high_0 + 1) : (high_0 - 1);
+				auto out_0  = is_plus ? (high_0 > high_mask) : (high_0 < 0);
+				auto out_1  = is_plus ? (high_1 > high_mask) : (high_1 < 0);
+				auto diff = carry ^ ((fill(out_0) & ~low_carry) | (fill(out_1) & low_carry));
+				for (size_t i = 0; i < LANE_BITS; i++) {
+					diff |= result[i] ^ lows[i];
+				}
+				for (size_t i = 0; i < high_bits; i++) {
+					auto expected = (fill((high_0 >> i) & 1) & ~low_carry) | (fill((high_1 >> i) & 1) & low_carry);
+					diff |= result[LANE_BITS + i] ^ expected;
+				}
+				report.add_mismatches(diff, uint64_t(x_high) << LANE_BITS, y);
+			}
+		}
+		report.Checked = uint64_t(1) << (2 * width);
+		return report;
+	}
+
+	// Checks every operand combination of given width (1 .. MAX_WIDTH) against native integers
+	Report verify(Operation operation, size_t width) {
+		if ((operation == Operation::Inverse) || (width < LANE_BITS)) {
+			return verify_by_lanes(operation, width);
+		}
+		return verify_by_words(operation, width);
+	}
+}
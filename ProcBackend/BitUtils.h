@@ -2,6 +2,7 @@
 
 #include <tuple>
 #include <bitset>
+#include <cstdint>
 
 #include "Architecture.h"
 
@@ -62,10 +63,30 @@ namespace BitUtils {
 		return get_set<1>(value);
 	}
 
+	// Gates use only bitwise operations, so the same circuit works on single bools
+	// and on bit-sliced words (bit k of every word belongs to k-th independent operation)
+	bool gate_not(bool a) {
+		return !a;
+	}
+
+	uint64_t gate_not(uint64_t a) {
+		return ~a;
+	}
+
+	template<class B>
+	tuple<B, B> full_adder(B a, B b, B carry) {
+		auto half = B(a ^ b);
+		return { B(half ^ carry), B((a & b) | (carry & half)) };
+	}
+
+	template<class B>
+	tuple<B, B> full_subtractor(B a, B b, B borrow) {
+		auto half = B(a ^ b);
+		return { B(half ^ borrow), B((gate_not(a) & b) | (gate_not(half) & borrow)) };
+	}
+
 	auto plus(bool a, bool b, bool carry) {
-		auto result    = carry ? a == b : a != b;
-		auto new_carry = (a && b) || (carry && a) || (carry && b);
-		return tuple { result, new_carry };
+		return full_adder(a, b, carry);
 	}
 
 	template<size_t BS = WORD_SIZE>
@@ -86,15 +107,13 @@ namespace BitUtils {
 		static_assert(BS > 0);
 		bitset<BS> result = { 0 };
 		for ( size_t i = 0; i < BS; i++ ) {
-			result[i] = !value[i];
+			result[i] = gate_not(bool(value[i]));
 		}
 		return result;
 	}
 	
 	auto minus(bool a, bool b, bool carry) {
-		auto result    = carry ? (a == b) : (a != b);
-		auto new_carry = b ? ((a == carry) || carry)  : (!a && carry);
-		return tuple { result, new_carry };
+		return full_subtractor(a, b, carry);
 	}
 	
 	template<size_t BS = WORD_SIZE>
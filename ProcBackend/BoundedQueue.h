@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+using std::atomic;
+using std::vector;
+
+namespace Utils {
+	// Lock-free bounded multi-producer multi-consumer queue (Vyukov):
+	// every cell has a sequence number telling whether it is ready for push or pop.
+	// Capacity is rounded up to power of two.
+	template<class T>
+	class BoundedQueue {
+		class Cell {
+		public:
+			atomic<size_t> Sequence;
+			T              Value;
+		};
+
+	public:
+		BoundedQueue(size_t capacity): _cells(round_up(capacity)), _mask(_cells.size() - 1) {
+			for (size_t i = 0; i < _cells.size(); i++) {
+				_cells[i].Sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		size_t capacity() const {
+			return _cells.size();
+		}
+
+		// Value is moved only on success
+		bool try_push(T& value) {
+			auto pos = _push_pos.load(std::memory_order_relaxed);
+			while (true) {
+				auto& cell = _cells[pos & _mask];
+				auto seq = cell.Sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+				if (diff == 0) {
+					if (_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						cell.Value = std::move(value);
+						cell.Sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					return false; // full
+				} else {
+					pos = _push_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		bool try_pop(T& value) {
+			auto pos = _pop_pos.load(std::memory_order_relaxed);
+			while (true) {
+				auto& cell = _cells[pos & _mask];
+				auto seq = cell.Sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+				if (diff == 0) {
+					if (_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						value = std::move(cell.Value);
+						cell.Sequence.store(pos + _mask + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					return false; // empty
+				} else {
+					pos = _pop_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	private:
+		vector<Cell> _cells;
+		const size_t _mask;
+
+		alignas(64) atomic<size_t> _push_pos = { 0 };
+		alignas(64) atomic<size_t> _pop_pos  = { 0 };
+
+		static size_t round_up(size_t value) {
+			size_t result = 1;
+			while (result < value) {
+				result <<= 1;
+			}
+			return result;
+		}
+	};
+}
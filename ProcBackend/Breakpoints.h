@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::vector;
+
+using Architecture::NativeWord;
+
+namespace Breakpoints {
+	enum class StopReason {
+		Breakpoint, // instruction at breakpoint address is about to be fetched
+		Register,   // CPU word became equal to the value
+		Write,      // watched RAM word was written
+		Flag,       // watched FS flag became set
+		TickLimit,  // tick count of the run is reached
+		Terminated, // tick returned false
+	};
+
+	const char* to_string(StopReason reason) {
+		switch (reason) {
+			case StopReason::Breakpoint: return "breakpoint";
+			case StopReason::Register:   return "register";
+			case StopReason::Write:      return "write";
+			case StopReason::Flag:       return "flag";
+			case StopReason::TickLimit:  return "tick limit reached";
+			case StopReason::Terminated: return "terminated";
+		}
+		return "unknown";
+	}
+
+	class Stop {
+	public:
+		StopReason Reason   = StopReason::Terminated;
+		uint64_t   Ticks    = 0; // ticks done by the run
+		size_t     Location = 0; // Breakpoint: IP, Register: CPU word index, Write: RAM address
+	};
+
+	// Set of addresses as a bitmap growing up to the highest address added
+	class AddressSet {
+	public:
+		void add(size_t address) {
+			auto index = address / 64;
+			if (index >= _bits.size()) {
+				_bits.resize(index + 1, 0);
+			}
+			_bits[index] |= uint64_t(1) << (address % 64);
+		}
+
+		bool contains(size_t address) const {
+			auto index = address / 64;
+			return (index < _bits.size()) && (((_bits[index] >> (address % 64)) & 1) != 0);
+		}
+
+		bool empty() const {
+			return _bits.empty();
+		}
+
+	private:
+		vector<uint64_t> _bits;
+	};
+
+	// Stop conditions of Computer::run_until, checked between ticks on plain words,
+	// only kinds of conditions which are set are checked
+	class Conditions {
+	public:
+		class RegisterValue {
+		public:
+			size_t     Index;
+			NativeWord Value;
+		};
+
+		AddressSet            Addresses;   // checked at fetch
+		AddressSet            Watches;     // checked on RAM write requests
+		vector<RegisterValue> Registers;
+		NativeWord            Flags = 0;   // FS bits
+		uint64_t              MaxTicks = 0; // 0 - no limit
+
+		Conditions& at(size_t ip) {
+			Addresses.add(ip);
+			return *this;
+		}
+
+		// index: CPU word index, e.g. SERVICE_REGISTERS + n for common register n
+		Conditions& when_register(size_t index, NativeWord value) {
+			Registers.push_back({ index, value });
+			return *this;
+		}
+
+		Conditions& on_write(size_t address) {
+			Watches.add(address);
+			return *this;
+		}
+
+		Conditions& on_write(size_t first, size_t last) {
+			for (auto address = first; address <= last; address++) {
+				Watches.add(address);
+			}
+			return *this;
+		}
+
+		// Logics::WordLayout FS bits, e.g. ZF_BIT | OF_BIT
+		Conditions& when_flags(NativeWord mask) {
+			Flags |= mask;
+			return *this;
+		}
+
+		Conditions& after_ticks(uint64_t ticks) {
+			MaxTicks = ticks;
+			return *this;
+		}
+	};
+
+	// Ticks machine until a condition is met. A breakpoint at the current instruction
+	// does not stop the run before its first tick, so runs can be resumed,
+	// register and flag conditions stop when they become true.
+	template<class Machine>
+	Stop run_until(Machine& machine, const Conditions& conditions) {
+		using namespace Logics::WordLayout;
+		const auto& state = machine.State;
+		const auto& cpu = state.CPU;
+		const auto check_addresses = !conditions.Addresses.empty();
+		const auto check_watches   = !conditions.Watches.empty();
+		const auto check_registers = !conditions.Registers.empty();
+		const auto check_flags     = conditions.Flags != 0;
+
+		vector<bool> matched(conditions.Registers.size(), false);
+		// Index of the first condition which became true, or count of conditions
+		auto match_registers = [&]() {
+			auto first = conditions.Registers.size();
+			for (size_t i = 0; i < conditions.Registers.size(); i++) {
+				const auto& condition = conditions.Registers[i];
+				auto now = (condition.Index < Machine::CpuSize) && (cpu.peek(condition.Index) == condition.Value);
+				if (now && !matched[i] && (first == conditions.Registers.size())) {
+					first = i;
+				}
+				matched[i] = now;
+			}
+			return first;
+		};
+		if (check_registers) {
+			match_registers();
+		}
+
+		Stop stop;
+		for (;;) {
+			if ((conditions.MaxTicks > 0) && (stop.Ticks >= conditions.MaxTicks)) {
+				stop.Reason = StopReason::TickLimit;
+				return stop;
+			}
+			if (check_addresses && (stop.Ticks > 0) && ((cpu.peek(SS) & PS_MASK) == Logics::Tick::Fetch)) {
+				auto ip = cpu.peek(IP);
+				if (conditions.Addresses.contains(ip)) {
+					stop.Reason = StopReason::Breakpoint;
+					stop.Location = ip;
+					return stop;
+				}
+			}
+			auto watched = false;
+			size_t address = 0;
+			if (check_watches) {
+				auto control = state.ControlBus.peek(0);
+				address = state.AddressBus.peek(0);
+				watched = ((control & (BUS_ENABLED | BUS_WRITE)) == (BUS_ENABLED | BUS_WRITE)) &&
+					(address < Machine::RamSize) && conditions.Watches.contains(address);
+			}
+			auto old_flags = check_flags ? cpu.peek(FS) : 0;
+
+			auto running = machine.tick();
+			stop.Ticks++;
+
+			if (watched) {
+				stop.Reason = StopReason::Write;
+				stop.Location = address;
+				return stop;
+			}
+			if (check_registers) {
+				auto index = match_registers();
+				if (index < conditions.Registers.size()) {
+					stop.Reason = StopReason::Register;
+					stop.Location = conditions.Registers[index].Index;
+					return stop;
+				}
+			}
+			if (check_flags && ((cpu.peek(FS) & ~old_flags & conditions.Flags) != 0)) {
+				stop.Reason = StopReason::Flag;
+				return stop;
+			}
+			if (!running) {
+				stop.Reason = StopReason::Terminated;
+				return stop;
+			}
+		}
+	}
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "Hash.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::tuple;
+using std::string;
+using std::vector;
+
+using Utils::MappedFile;
+using Architecture::NativeWord;
+using Architecture::WORD_SIZE;
+using Architecture::WORD_BYTES;
+
+namespace BusTrace {
+	// RAM access done by RamRunner in one tick, as requested on the buses by the previous tick
+	class Transaction {
+	public:
+		uint64_t   Tick    = 0; // tick (from 1) the access is done in
+		bool       Write   = false;
+		uint32_t   Address = 0;
+		NativeWord Data    = 0; // value written, or value read (0 out of RAM)
+
+		bool operator==(const Transaction& other) const {
+			return (Tick == other.Tick) && (Write == other.Write) && (Address == other.Address) && (Data == other.Data);
+		}
+
+		bool operator!=(const Transaction& other) const {
+			return !(*this == other);
+		}
+	};
+
+	class Trace {
+	public:
+		vector<NativeWord>  InitialRam;
+		vector<Transaction> Transactions;
+		uint64_t            Ticks = 0; // recorded ticks
+	};
+
+	// Records RAM transactions of a machine with Computer-like State till termination
+	// or tick limit (0 - no limit)
+	template<class Machine>
+	Trace record(Machine& machine, uint64_t max_ticks = 0) {
+		using namespace Logics::WordLayout;
+		const auto& state = machine.State;
+		Trace trace;
+		trace.InitialRam.resize(Machine::RamSize);
+		for (size_t i = 0; i < Machine::RamSize; i++) {
+			trace.InitialRam[i] = NativeWord(state.RAM.peek(i));
+		}
+		auto running = true;
+		while (running && ((max_ticks == 0) || (trace.Ticks < max_ticks))) {
+			auto control = state.ControlBus.peek(0);
+			auto address = uint32_t(state.AddressBus.peek(0));
+			if (control & BUS_ENABLED) {
+				// Read does not change RAM, so value read is known before the tick
+				Transaction transaction;
+				transaction.Tick    = trace.Ticks + 1;
+				transaction.Write   = (control & BUS_WRITE) != 0;
+				transaction.Address = address;
+				if (transaction.Write) {
+					transaction.Data = NativeWord(state.DataBus.peek(0));
+				} else if (address < Machine::RamSize) {
+					transaction.Data = NativeWord(state.RAM.peek(address));
+				}
+				trace.Transactions.push_back(transaction);
+			}
+			running = machine.tick();
+			trace.Ticks++;
+		}
+		return trace;
+	}
+
+	// Drives RAM side from the trace without CPU logic: applies writes to initial RAM,
+	// every read must see the value replayed RAM has at that moment.
+	tuple<bool, string> replay(const Trace& trace, vector<NativeWord>& ram) {
+		ram = trace.InitialRam;
+		for (const auto& transaction : trace.Transactions) {
+			auto in_range = transaction.Address < ram.size();
+			if (transaction.Write) {
+				if (in_range) {
+					ram[transaction.Address] = transaction.Data;
+				}
+			} else if ((in_range ? ram[transaction.Address] : 0) != transaction.Data) {
+				return { false, "read at tick " + std::to_string(transaction.Tick) + " does not match replayed RAM" };
+			}
+		}
+		return { true, "" };
+	}
+
+	class Divergence {
+	public:
+		bool     Found = false;
+		size_t   Index = 0; // first different transaction
+		uint64_t Tick  = 0; // earliest tick of the transactions at Index
+	};
+
+	// First point two engines differ at, a missing transaction counts as a difference
+	Divergence find_divergence(const Trace& a, const Trace& b) {
+		Divergence divergence;
+		auto common = std::min(a.Transactions.size(), b.Transactions.size());
+		size_t i = 0;
+		while ((i < common) && (a.Transactions[i] == b.Transactions[i])) {
+			i++;
+		}
+		if ((i == common) && (a.Transactions.size() == b.Transactions.size())) {
+			return divergence;
+		}
+		divergence.Found = true;
+		divergence.Index = i;
+		if (i == common) {
+			divergence.Tick = (i < a.Transactions.size()) ? a.Transactions[i].Tick : b.Transactions[i].Tick;
+		} else {
+			divergence.Tick = std::min(a.Transactions[i].Tick, b.Transactions[i].Tick);
+		}
+		return divergence;
+	}
+
+	// Trace file layout, header numbers are little-endian:
+	//  0 char[4] magic "CPBT"
+	//  4 uint16  format version
+	//  6 uint16  word size in bits
+	//  8 uint32  RAM size in words
+	// 12 uint32  reserved (0)
+	// 16 uint64  recorded ticks
+	// 24 uint64  transactions count
+	// 32 uint64  checksum of payload (FNV-1a)
+	// 40 payload: initial RAM words, WORD_BYTES bytes per word, then transactions:
+	//    varint (tick - previous tick) * 2 + write
+	//    varint zigzag(address - previous address - 1), sequential fetches take one byte
+	//    data, WORD_BYTES bytes
+	const char     MAGIC[4]    = { 'C', 'P', 'B', 'T' };
+	const uint16_t VERSION     = 1;
+	const size_t   HEADER_SIZE = 40;
+
+	void write_varint(std::ostream& os, uint64_t value) {
+		while (value >= 0x80) {
+			os.put(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		os.put(static_cast<char>(value));
+	}
+
+	bool read_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+		value = 0;
+		for (size_t shift = 0; (data < end) && (shift < 64); shift += 7) {
+			auto byte = *data++;
+			value |= uint64_t(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint64_t zigzag(int64_t value) {
+		return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+	}
+
+	int64_t unzigzag(uint64_t value) {
+		return int64_t(value >> 1) ^ -int64_t(value & 1);
+	}
+
+	tuple<bool, string> save(const string& path, const Trace& trace) {
+		std::ostringstream payload;
+		for (auto word : trace.InitialRam) {
+			Images::write_le(payload, word, WORD_BYTES);
+		}
+		uint64_t tick = 0;
+		int64_t address = -1;
+		for (const auto& transaction : trace.Transactions) {
+			write_varint(payload, ((transaction.Tick - tick) << 1) | (transaction.Write ? 1 : 0));
+			write_varint(payload, zigzag(int64_t(transaction.Address) - address - 1));
+			Images::write_le(payload, transaction.Data, WORD_BYTES);
+			tick = transaction.Tick;
+			address = transaction.Address;
+		}
+		auto bytes = payload.str();
+
+		auto f = std::ofstream(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!f.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		f.write(MAGIC, sizeof(MAGIC));
+		Images::write_le<uint16_t>(f, VERSION);
+		Images::write_le<uint16_t>(f, WORD_SIZE);
+		Images::write_le<uint32_t>(f, uint32_t(trace.InitialRam.size()));
+		Images::write_le<uint32_t>(f, 0);
+		Images::write_le<uint64_t>(f, trace.Ticks);
+		Images::write_le<uint64_t>(f, trace.Transactions.size());
+		Images::write_le<uint64_t>(f, Utils::hash_bytes(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()));
+		f.write(bytes.data(), bytes.size());
+		f.close();
+		if (f.fail()) {
+			return { false, "can't write file: " + path };
+		}
+		return { true, "" };
+	}
+
+	tuple<bool, string> load(const string& path, Trace& trace) {
+		auto file = MappedFile(path);
+		if (!file.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		file.advise_sequential();
+		auto data = file.data();
+		auto size = file.size();
+		if ((size < HEADER_SIZE) || (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)) {
+			return { false, "not a bus trace file" };
+		}
+		auto version   = Images::read_le<uint16_t>(data + 4);
+		auto word_size = Images::read_le<uint16_t>(data + 6);
+		auto ram_size  = Images::read_le<uint32_t>(data + 8);
+		auto ticks     = Images::read_le<uint64_t>(data + 16);
+		auto count     = Images::read_le<uint64_t>(data + 24);
+		auto checksum  = Images::read_le<uint64_t>(data + 32);
+		if (version != VERSION) {
+			return { false, "unsupported version " + std::to_string(version) };
+		}
+		if (word_size != WORD_SIZE) {
+			return { false, "word size " + std::to_string(word_size) + " != " + std::to_string(WORD_SIZE) };
+		}
+		auto payload = data + HEADER_SIZE;
+		auto end = data + size;
+		if (Utils::hash_bytes(payload, size - HEADER_SIZE) != checksum) {
+			return { false, "checksum mismatch" };
+		}
+		if (size_t(end - payload) < size_t(ram_size) * WORD_BYTES) {
+			return { false, "trace is truncated" };
+		}
+
+		trace = Trace();
+		trace.Ticks = ticks;
+		trace.InitialRam.resize(ram_size);
+		for (auto& word : trace.InitialRam) {
+			word = Images::read_le<NativeWord>(payload, WORD_BYTES);
+			payload += WORD_BYTES;
+		}
+		trace.Transactions.reserve(count);
+		uint64_t tick = 0;
+		int64_t address = -1;
+		for (uint64_t i = 0; i < count; i++) {
+			uint64_t tick_delta = 0, address_delta = 0;
+			if (!read_varint(payload, end, tick_delta) || !read_varint(payload, end, address_delta) || (size_t(end - payload) < WORD_BYTES)) {
+				return { false, "trace is truncated" };
+			}
+			Transaction transaction;
+			tick += tick_delta >> 1;
+			address += unzigzag(address_delta) + 1;
+			transaction.Tick    = tick;
+			transaction.Write   = (tick_delta & 1) != 0;
+			transaction.Address = uint32_t(address);
+			transaction.Data    = Images::read_le<NativeWord>(payload, WORD_BYTES);
+			payload += WORD_BYTES;
+			trace.Transactions.push_back(transaction);
+		}
+		return { true, "" };
+	}
+}
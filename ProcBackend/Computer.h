@@ -2,32 +2,91 @@
 
 #include <bitset>
 
+#include "Events.h"
+#include "Breakpoints.h"
 #include "Logger.h"
 #include "CpuRunner.h"
 #include "RamRunner.h"
+#include "WordRunner.h"
 #include "Architecture.h"
 #include "ComputerState.h"
+#include "Instrumentation.h"
 
 using std::bitset;
 
 using Utils::LogType;
 using Logics::RamRunner;
 using Logics::CpuRunner;
+using State::PageStats;
 using State::ComputerState;
 using Architecture::WordSet;
 using Architecture::RegisterSet;
 
 namespace Core {
-	template<size_t InternalMemorySize, size_t RamMemorySize>
-	class Computer {
+	// RamPaging: State::DensePaging or State::SparsePaging for large mostly empty RAM.
+	// The probe is a private base, so an empty policy (NoProbe) takes no bytes of the object.
+	template<size_t InternalMemorySize, size_t RamMemorySize, class ProbePolicy = Instrumentation::NoProbe, class RamPaging = State::DensePaging>
+	class Computer : private ProbePolicy {
 		using Regs      = RegisterSet  <InternalMemorySize>;
-		using CompState = ComputerState<InternalMemorySize, RamMemorySize>;
+		using CompState = ComputerState<InternalMemorySize, RamMemorySize, RamPaging>;
 	public:
-		Regs      Registers;
-		CompState State;
+		static constexpr size_t CpuSize = InternalMemorySize;
+		static constexpr size_t RamSize = RamMemorySize;
+
+		CompState   State;
+		static constexpr Regs Registers = { }; // layout constants only
+
+		// Machine state to come back to, shares memory pages with the computer it was taken from
+		class Snapshot {
+		public:
+			CompState   State;
+			ProbePolicy Probe;
+		};
 
 		Computer(WordSet<RamMemorySize> init_ram):State(init_ram) { }
 
+		Computer(const Snapshot& snapshot):ProbePolicy(snapshot.Probe), State(snapshot.State) { }
+
+		ProbePolicy& get_probe() {
+			return *this;
+		}
+
+		const ProbePolicy& get_probe() const {
+			return *this;
+		}
+
+		// O(1) copy of the state, memory pages are copied later by the first write to them
+		Snapshot snapshot() const {
+			return { State, get_probe() };
+		}
+
+		void restore(const Snapshot& snapshot) {
+			State = snapshot.State;
+			get_probe() = snapshot.Probe;
+		}
+
+		// Independent computer continuing from the current state, O(1) like snapshot()
+		Computer fork() const {
+			return Computer(snapshot());
+		}
+
+		// Pages of CPU and RAM shared with snapshots and forks
+		PageStats get_page_stats() const {
+			return State.get_page_stats();
+		}
+
+		// Memory used by this computer only: the object, its private pages and page tables with
+		// their control blocks. A lower bound, heap allocator headers and rounding are not counted
+		size_t get_instance_bytes() const {
+			return sizeof(Computer) + get_page_stats().PrivateBytes;
+		}
+
+		// Brings computer to the state right after construction with given RAM, O(RAM)
+		void reset(const WordSet<RamMemorySize>& init_ram) {
+			State.reset(init_ram);
+			get_probe() = ProbePolicy();
+		}
+
 		bool tick(size_t ticks = 1) {
 			for (size_t i = 0; i < ticks; i++) {
 				Utils::log_line(LogType::Computer, "Computer.tick(", i, ")");
@@ -42,12 +101,29 @@ namespace Core {
 			return true;
 		}
 
+		// Lazy stream of execution events, ticks are done while the stream is pulled.
+		// Kinds selects event kinds at compile time, e.g. Events::mask(Events::Kind::Retired)
+		template<uint32_t Kinds = Events::ALL>
+		auto run(uint64_t max_ticks = 0) {
+			return Events::Stream<Computer, Kinds>(*this, max_ticks);
+		}
+
+		// Ticks until one of the conditions is met, see Breakpoints::run_until
+		Breakpoints::Stop run_until(const Breakpoints::Conditions& conditions) {
+			return Breakpoints::run_until(*this, conditions);
+		}
+
 		bool tick_ram() {
 			auto& control = State.ControlBus;
 			auto& address = State.AddressBus;
 			auto& data    = State.DataBus;
 			auto& ram     = State.RAM;
-			return RamRunner<RamMemorySize>(control, address, data, ram).tick();
+			if constexpr (ProbePolicy::Enabled) {
+				get_probe().begin_tick(is_fetch_pending());
+				return RamRunner<RamMemorySize, ProbePolicy, RamPaging>(control, address, data, ram, get_probe()).tick();
+			} else {
+				return RamRunner<RamMemorySize, Instrumentation::NoProbe, RamPaging>(control, address, data, ram).tick();
+			}
 		}
 
 		bool tick_cpu() {
@@ -55,7 +131,32 @@ namespace Core {
 			auto& address = State.AddressBus;
 			auto& data    = State.DataBus;
 			auto& cpu     = State.CPU;
+			if constexpr (ProbePolicy::Enabled) {
+				// One unlogged word read per tick, the rest once per executed instruction
+				using namespace Logics::WordLayout;
+				if ((cpu.peek(SS) & PS_MASK) == Logics::Tick::Execute_1) {
+					auto flags = cpu.peek(FS);
+					if ((flags & TR_BIT) == 0) {
+						get_probe().on_execute(cpu.peek(IP), cpu.peek(CC), (flags & ZF_BIT) != 0);
+					}
+				}
+			}
 			return CpuRunner<InternalMemorySize, RamMemorySize>(Registers, cpu, control, address, data).tick();
 		}
+
+	private:
+		// RAM request pending on the bus was made by decode or read steps,
+		// so it is a command code or argument fetch, not a data access
+		bool is_fetch_pending() const {
+			auto state = State.CPU.peek(Logics::WordLayout::SS) & Logics::WordLayout::PS_MASK;
+			return (state >= Logics::Tick::Decode) && (state <= Logics::Tick::Read_2);
+		}
 	};
+
+	// Architectural state is in memory pages, the object itself is two memory states
+	// (a name and a page table pointer each), bus words and padding, so idle machines cost little:
+	// 56 bytes with words up to 16 bits, 64 with 32-bit words on 64-bit hosts
+	static_assert(sizeof(Computer<Architecture::MIN_MEMORY_SIZE, 1>) <= 64);
+	static_assert(sizeof(Computer<Architecture::MIN_MEMORY_SIZE, 1>) == sizeof(ComputerState<Architecture::MIN_MEMORY_SIZE, 1>),
+		"registers and an empty probe take no bytes");
 }
@@ -5,18 +5,35 @@
 #include "MemoryState.h"
 #include "Architecture.h"
 
+using State::PageStats;
 using Architecture::WordSet;
 
 namespace State {
-	template<size_t IMS, size_t RMS>
+	template<size_t IMS, size_t RMS, class RamPaging = DensePaging>
 	class ComputerState {
 	public:
 		MemoryState<IMS>       CPU        = { "CPU"     };
-		State::ControlBusState ControlBus = { "Control" };
-		State::AddressBusState AddressBus = { "Address" };
-		State::DataBusState    DataBus    = { "Data"    };
-		MemoryState<RMS>       RAM;
+		State::ControlBusState ControlBus;
+		State::AddressBusState AddressBus;
+		State::DataBusState    DataBus;
+		MemoryState<RMS, RamPaging> RAM;
 
 		ComputerState(WordSet<RMS> ram_memory): RAM("RAM", ram_memory) {}
+
+		// Same as constructing new state, without reallocation
+		void reset(const WordSet<RMS>& ram_memory) {
+			CPU.clear();
+			ControlBus.clear();
+			AddressBus.clear();
+			DataBus.clear();
+			RAM.load(ram_memory);
+		}
+
+		// Buses are not paged, they are copied with the state
+		PageStats get_page_stats() const {
+			auto stats = CPU.get_page_stats();
+			stats += RAM.get_page_stats();
+			return stats;
+		}
 	};
 }
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <variant>
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "Image.h"
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::array;
+using std::vector;
+
+using Images::Image;
+using Logics::WordTick;
+using Logics::WordRunner;
+using Architecture::NativeWord;
+using Architecture::MIN_MEMORY_SIZE;
+
+namespace Core {
+	// Computer with CPU memory and RAM sizes chosen at construction, one class for all sizes.
+	// Words are plain integers: the buses, then CPU words and RAM in one contiguous block,
+	// kept inside the object for small machines and on the heap for larger ones.
+	// Ticks are done by WordRunner and match Computer tick by tick,
+	// including the exception for a common register index out of range.
+	class DynamicComputer {
+	public:
+		static const size_t INLINE_WORDS = 64; // CPU words and RAM kept inside the object
+
+		// cpu_size is at least MIN_MEMORY_SIZE, RAM size is the size of init_ram
+		DynamicComputer(size_t cpu_size, const vector<NativeWord>& init_ram):
+			_cpu_size(std::max(cpu_size, MIN_MEMORY_SIZE)) {
+			reset(init_ram);
+		}
+
+		// Initial registers, entry IP and RAM of the image, like Image::apply on Computer
+		template<size_t IMS, size_t RMS>
+		static DynamicComputer from_image(const Image<IMS, RMS>& image) {
+			vector<NativeWord> ram(RMS);
+			for (size_t i = 0; i < RMS; i++) {
+				ram[i] = NativeWord(image.Ram[i].to_ulong());
+			}
+			auto cmp = DynamicComputer(IMS, ram);
+			for (size_t i = 0; i < IMS; i++) {
+				cmp.cpu(i) = NativeWord(image.Registers[i].to_ulong());
+			}
+			if (image.EntryIP != 0) {
+				cmp.cpu(Logics::WordLayout::IP) = NativeWord(image.EntryIP);
+			}
+			return cmp;
+		}
+
+		// Same as constructing new computer with the same CPU size, RAM size may change
+		void reset(const vector<NativeWord>& init_ram) {
+			if (_cpu_size + init_ram.size() <= INLINE_WORDS) {
+				_words = InlineWords(_cpu_size, init_ram);
+			} else {
+				_words = HeapWords(_cpu_size, init_ram);
+			}
+		}
+
+		bool tick(size_t ticks = 1) {
+			if (auto words = std::get_if<InlineWords>(&_words)) {
+				return tick(*words, ticks);
+			}
+			return tick(std::get<HeapWords>(_words), ticks);
+		}
+
+		// Same access as WordRunner lane
+		NativeWord& cpu(size_t index)        { return std::visit([index](auto& w) -> NativeWord& { return w.cpu(index); }, _words); }
+		NativeWord& ram(size_t address)      { return std::visit([address](auto& w) -> NativeWord& { return w.ram(address); }, _words); }
+		NativeWord& control()                { return std::visit([](auto& w) -> NativeWord& { return w.control(); }, _words); }
+		NativeWord& address()                { return std::visit([](auto& w) -> NativeWord& { return w.address(); }, _words); }
+		NativeWord& data()                   { return std::visit([](auto& w) -> NativeWord& { return w.data(); }, _words); }
+		size_t cpu_size() const              { return _cpu_size; }
+		size_t ram_size() const              { return std::visit([](const auto& w) { return w.ram_size(); }, _words); }
+
+		NativeWord cpu(size_t index) const   { return std::visit([index](const auto& w) { return w.get(index); }, _words); }
+		NativeWord ram(size_t address) const { return std::visit([this, address](const auto& w) { return w.get(_cpu_size + address); }, _words); }
+		NativeWord control() const           { return std::visit([](const auto& w) { return w.get_bus(0); }, _words); }
+		NativeWord address() const           { return std::visit([](const auto& w) { return w.get_bus(1); }, _words); }
+		NativeWord data() const              { return std::visit([](const auto& w) { return w.get_bus(2); }, _words); }
+
+		bool is_fatal() const {
+			return (cpu(Logics::WordLayout::FS) & Logics::WordLayout::FT_BIT) != 0;
+		}
+
+	private:
+		// Storages are lanes of WordRunner themselves: word stores may alias any memory,
+		// so a lane pointing to the words would have its pointers reloaded after each store
+		template<class Block>
+		class Words {
+		public:
+			Words(size_t cpu_size, const vector<NativeWord>& init_ram):
+				_cpu_size(cpu_size), _ram_size(init_ram.size()) {
+				if constexpr (!std::is_same_v<Block, InlineBlock>) {
+					_block.resize(cpu_size + init_ram.size());
+				}
+				std::copy(init_ram.begin(), init_ram.end(), _block.begin() + cpu_size);
+			}
+
+			NativeWord& cpu(size_t index)   { return _block[index]; }
+			NativeWord& ram(size_t address) { return _block[_cpu_size + address]; }
+			NativeWord& control()           { return _buses[0]; }
+			NativeWord& address()           { return _buses[1]; }
+			NativeWord& data()              { return _buses[2]; }
+			size_t cpu_size() const         { return _cpu_size; }
+			size_t ram_size() const         { return _ram_size; }
+
+			NativeWord get(size_t index) const    { return _block[index]; }
+			NativeWord get_bus(size_t bus) const  { return _buses[bus]; }
+
+		private:
+			array<NativeWord, 3> _buses = { };
+			size_t               _cpu_size;
+			size_t               _ram_size;
+			Block                _block = { };
+		};
+
+		using InlineBlock = array<NativeWord, INLINE_WORDS>;
+		using InlineWords = Words<InlineBlock>;
+		using HeapWords   = Words<vector<NativeWord>>;
+
+		size_t                               _cpu_size;
+		std::variant<InlineWords, HeapWords> _words = InlineWords(MIN_MEMORY_SIZE, { });
+
+		template<class Lane>
+		static bool tick(Lane& lane, size_t ticks) {
+			auto runner = WordRunner<Lane>(lane);
+			for (size_t i = 0; i < ticks; i++) {
+				switch (runner.tick()) {
+					case WordTick::Running:
+						break;
+					case WordTick::Stopped:
+						return false;
+					case WordTick::Invalid:
+						throw new std::runtime_error("Invalid C register index");
+				}
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::array;
+
+using Architecture::NativeWord;
+
+namespace Events {
+	enum class Kind : uint32_t {
+		Retired    = 0b0001, // instruction finished its execute steps
+		RamWrite   = 0b0010, // RAM word was written
+		FlagChange = 0b0100, // FS register changed
+		Terminated = 0b1000, // tick returned false, always the last event
+	};
+
+	constexpr uint32_t mask(Kind kind) {
+		return static_cast<uint32_t>(kind);
+	}
+
+	template<class ...Kinds>
+	constexpr uint32_t mask(Kind kind, Kinds... kinds) {
+		return mask(kind) | mask(kinds...);
+	}
+
+	const uint32_t ALL = mask(Kind::Retired, Kind::RamWrite, Kind::FlagChange, Kind::Terminated);
+
+	class Event {
+	public:
+		Kind       Type     = Kind::Retired;
+		uint64_t   Tick     = 0; // tick (from 1) the event happened in
+		uint32_t   IP       = 0; // Retired: instruction address
+		NativeWord Code     = 0; // Retired: command code
+		NativeWord X        = 0; // Retired: argument #1
+		NativeWord Y        = 0; // Retired: argument #2
+		uint32_t   Address  = 0; // RamWrite
+		NativeWord Value    = 0; // RamWrite
+		NativeWord OldFlags = 0; // FlagChange: FS before the tick
+		NativeWord NewFlags = 0; // FlagChange: FS after the tick
+		bool       Fatal    = false; // Terminated
+	};
+
+	// Pull-based event stream of one machine: next() ticks the machine lazily
+	// until an event of a wanted kind appears. Kinds is a compile-time mask,
+	// state needed only by unwanted kinds is never read.
+	// Stream is a plain object, so many machines can be interleaved on one thread
+	// by calling next() of their streams in turn.
+	template<class Machine, uint32_t Kinds = ALL>
+	class Stream {
+		static const size_t MAX_PENDING = 4; // one event of every kind per tick
+
+	public:
+		class Iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type        = Event;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const Event*;
+			using reference         = const Event&;
+
+			Iterator(Stream* stream = nullptr): _stream(stream) {
+				advance();
+			}
+
+			const Event& operator*() const  { return _event; }
+			const Event* operator->() const { return &_event; }
+
+			Iterator& operator++() {
+				advance();
+				return *this;
+			}
+
+			bool operator==(const Iterator& other) const { return _stream == other._stream; }
+			bool operator!=(const Iterator& other) const { return _stream != other._stream; }
+
+		private:
+			Stream* _stream;
+			Event   _event;
+
+			void advance() {
+				if ((_stream != nullptr) && !_stream->next(_event)) {
+					_stream = nullptr;
+				}
+			}
+		};
+
+		// max_ticks: 0 - until termination
+		Stream(Machine& machine, uint64_t max_ticks = 0): _machine(machine), _max_ticks(max_ticks) { }
+
+		bool next(Event& event) {
+			while ((_count == 0) && !_done) {
+				step();
+			}
+			if (_count == 0) {
+				return false;
+			}
+			event = _pending[_first];
+			_first = (_first + 1) % MAX_PENDING;
+			_count--;
+			return true;
+		}
+
+		Iterator begin() { return Iterator(this); }
+		Iterator end()   { return Iterator(); }
+
+		// Machine terminated or tick limit is reached
+		bool is_done() const {
+			return _done && (_count == 0);
+		}
+
+		uint64_t get_ticks() const {
+			return _ticks;
+		}
+
+	private:
+		Machine&                    _machine;
+		const uint64_t              _max_ticks;
+		uint64_t                    _ticks = 0;
+		bool                        _done  = false;
+		array<Event, MAX_PENDING>   _pending;
+		size_t                      _first = 0;
+		size_t                      _count = 0;
+
+		static constexpr bool wants(Kind kind) {
+			return (Kinds & mask(kind)) != 0;
+		}
+
+		Event& push(Kind kind) {
+			auto& event = _pending[(_first + _count) % MAX_PENDING];
+			_count++;
+			event = Event();
+			event.Type = kind;
+			event.Tick = _ticks;
+			return event;
+		}
+
+		auto peek_cpu(size_t index) const {
+			return NativeWord(_machine.State.CPU.peek(index));
+		}
+
+		void step() {
+			using namespace Logics::WordLayout;
+			const auto& state = _machine.State;
+
+			// RAM write requested by the previous tick is done by this one
+			auto write = false;
+			uint32_t address = 0;
+			NativeWord value = 0;
+			if constexpr (wants(Kind::RamWrite)) {
+				auto control = state.ControlBus.peek(0);
+				address = uint32_t(state.AddressBus.peek(0));
+				write = ((control & (BUS_ENABLED | BUS_WRITE)) == (BUS_ENABLED | BUS_WRITE)) && (address < Machine::RamSize);
+				value = NativeWord(state.DataBus.peek(0));
+			}
+
+			NativeWord step = 0, ip = 0, code = 0, x = 0, y = 0;
+			if constexpr (wants(Kind::Retired)) {
+				step = peek_cpu(SS) & PS_MASK;
+				if ((step == Logics::Tick::Execute_1) || (step == Logics::Tick::Execute_2)) {
+					ip   = peek_cpu(IP);
+					code = peek_cpu(CC);
+					x    = peek_cpu(A1);
+					y    = peek_cpu(A2);
+				}
+			}
+
+			NativeWord old_flags = 0;
+			if constexpr (wants(Kind::FlagChange)) {
+				old_flags = peek_cpu(FS);
+			}
+
+			auto running = _machine.tick();
+			_ticks++;
+
+			if constexpr (wants(Kind::RamWrite)) {
+				if (write) {
+					auto& event = push(Kind::RamWrite);
+					event.Address = address;
+					event.Value   = value;
+				}
+			}
+			if constexpr (wants(Kind::Retired)) {
+				// LD/LDA go on to Execute_2 and retire there
+				auto next_step = peek_cpu(SS) & PS_MASK;
+				auto executed = (step == Logics::Tick::Execute_2) ||
+					((step == Logics::Tick::Execute_1) && (next_step != Logics::Tick::Execute_2));
+				if (executed && (get_arguments(code) >= 0)) {
+					auto& event = push(Kind::Retired);
+					event.IP   = ip;
+					event.Code = code;
+					event.X    = x;
+					event.Y    = y;
+				}
+			}
+			if constexpr (wants(Kind::FlagChange)) {
+				auto new_flags = peek_cpu(FS);
+				if (new_flags != old_flags) {
+					auto& event = push(Kind::FlagChange);
+					event.OldFlags = old_flags;
+					event.NewFlags = new_flags;
+				}
+			}
+			if (!running) {
+				_done = true;
+				if constexpr (wants(Kind::Terminated)) {
+					push(Kind::Terminated).Fatal = (peek_cpu(FS) & FT_BIT) != 0;
+				}
+			} else if ((_max_ticks > 0) && (_ticks >= _max_ticks)) {
+				_done = true;
+			}
+		}
+	};
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include "Image.h"
+#include "Computer.h"
+#include "Architecture.h"
+
+using std::deque;
+using std::mutex;
+using std::thread;
+using std::vector;
+using std::function;
+using std::lock_guard;
+using std::unique_ptr;
+using std::unique_lock;
+using std::condition_variable;
+
+using Core::Computer;
+using Images::Image;
+using Architecture::WordSet;
+
+namespace Fleet {
+	using Clock = std::chrono::steady_clock;
+
+	enum class JobStatus {
+		Terminated, // terminated without Fatal flag
+		Fatal,      // terminated with Fatal flag
+		TickLimit,  // tick budget is exhausted
+		Deadline,   // wall-clock deadline is reached
+		Invalid,    // computer threw on the program (e.g. common register out of range)
+	};
+
+	const char* to_string(JobStatus status) {
+		switch (status) {
+			case JobStatus::Terminated: return "terminated";
+			case JobStatus::Fatal:      return "fatal";
+			case JobStatus::TickLimit:  return "tick limit reached";
+			case JobStatus::Deadline:   return "deadline reached";
+			case JobStatus::Invalid:    return "invalid program";
+		}
+		return "unknown";
+	}
+
+	template<size_t IMS, size_t RMS>
+	class Job {
+	public:
+		size_t                    Id       = 0;
+		Image<IMS, RMS>           Program;
+		size_t                    MaxTicks = 0; // 0 - unlimited
+		std::chrono::microseconds Timeout  = std::chrono::microseconds::zero(); // zero - no deadline
+	};
+
+	template<size_t IMS, size_t RMS>
+	class Result {
+	public:
+		size_t       Id     = 0;
+		JobStatus    Status = JobStatus::Terminated;
+		size_t       Ticks  = 0;
+		WordSet<IMS> Cpu    = { };
+		WordSet<RMS> Ram    = { };
+	};
+
+	template<size_t TS>
+	void store_words(const bitset<TS>& mem, Word* words, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			words[i] = BitUtils::get_bits(mem, i * Architecture::WORD_SIZE);
+		}
+	}
+
+	// Runs job on given computer, which is reset first.
+	// Ticks are done in slices, deadline is checked between slices,
+	// so preempted job ends at a tick boundary with consistent state.
+	template<size_t IMS, size_t RMS>
+	Result<IMS, RMS> run_job(Computer<IMS, RMS>& cmp, const Job<IMS, RMS>& job) {
+		const size_t SLICE = 1024;
+
+		cmp.reset(job.Program.Ram);
+		job.Program.apply(cmp);
+
+		Result<IMS, RMS> result;
+		result.Id = job.Id;
+		auto has_deadline = job.Timeout.count() > 0;
+		auto deadline = Clock::now() + job.Timeout;
+		auto running = true;
+		while (running) {
+			auto slice = SLICE;
+			if (job.MaxTicks > 0) {
+				slice = std::min(slice, job.MaxTicks - result.Ticks);
+				if (slice == 0) {
+					break;
+				}
+			}
+			for (size_t i = 0; (i < slice) && running; i++) {
+				running = cmp.tick();
+				result.Ticks++;
+			}
+			if (running && has_deadline && (Clock::now() >= deadline)) {
+				break;
+			}
+		}
+
+		if (running) {
+			auto budget_spent = (job.MaxTicks > 0) && (result.Ticks >= job.MaxTicks);
+			result.Status = budget_spent ? JobStatus::TickLimit : JobStatus::Deadline;
+		} else {
+			auto fatal = cmp.State.CPU[cmp.Registers.Fatal].test(0);
+			result.Status = fatal ? JobStatus::Fatal : JobStatus::Terminated;
+		}
+		store_words(cmp.State.CPU.get_all(), result.Cpu.data(), IMS);
+		store_words(cmp.State.RAM.get_all(), result.Ram.data(), RMS);
+		return result;
+	}
+
+	// Result of a job whose run threw, with the machine state at that point; ticks are not known
+	template<size_t IMS, size_t RMS>
+	Result<IMS, RMS> get_invalid_result(const Computer<IMS, RMS>& cmp, const Job<IMS, RMS>& job) {
+		Result<IMS, RMS> result;
+		result.Id     = job.Id;
+		result.Status = JobStatus::Invalid;
+		store_words(cmp.State.CPU.get_all(), result.Cpu.data(), IMS);
+		store_words(cmp.State.RAM.get_all(), result.Ram.data(), RMS);
+		return result;
+	}
+
+	// Fixed set of worker threads, each with own job deque.
+	// Threads are started once and sleep between runs, run() deals jobs and wakes them.
+	// Jobs are dealt round-robin, worker takes jobs from front of its deque,
+	// when it is empty it steals from back of other deques.
+	// Computers are pooled (one per worker) and kept between runs, every job only resets one.
+	// Concurrent calls of run() are serialized.
+	// A job whose run throws gets JobStatus::Invalid, the other jobs are not affected.
+	template<size_t IMS, size_t RMS>
+	class Executor {
+		using Machine = Computer<IMS, RMS>;
+
+		class Worker {
+		public:
+			mutex         Mutex;
+			deque<size_t> Jobs;
+		};
+
+	public:
+		Executor(size_t threads = std::thread::hardware_concurrency()):
+			_threads(std::max<size_t>(threads, 1)) {
+			for (size_t i = 0; i < _threads; i++) {
+				_pool.push_back(std::make_unique<Machine>(WordSet<RMS>()));
+				_workers.push_back(std::make_unique<Worker>());
+			}
+			for (size_t i = 0; i < _threads; i++) {
+				_worker_threads.emplace_back(&Executor::work_loop, this, i);
+			}
+		}
+
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+
+		~Executor() {
+			{
+				lock_guard<mutex> lock(_mutex);
+				_stopped = true;
+			}
+			_started.notify_all();
+			for (auto& t : _worker_threads) {
+				t.join();
+			}
+		}
+
+		size_t get_threads() const {
+			return _threads;
+		}
+
+		// Results are in the same order as jobs
+		vector<Result<IMS, RMS>> run(const vector<Job<IMS, RMS>>& jobs) {
+			return run(jobs, run_job<IMS, RMS>);
+		}
+
+		// runner(Computer<IMS, RMS>&, const Job<IMS, RMS>&) returns the result of the job,
+		// e.g. ResultCache, it is called from all worker threads
+		template<class Runner>
+		vector<Result<IMS, RMS>> run(const vector<Job<IMS, RMS>>& jobs, Runner&& runner) {
+			lock_guard<mutex> run_lock(_run_mutex);
+			vector<Result<IMS, RMS>> results(jobs.size());
+			for (size_t i = 0; i < jobs.size(); i++) {
+				auto& worker = *_workers[i % _threads];
+				lock_guard<mutex> lock(worker.Mutex);
+				worker.Jobs.push_back(i);
+			}
+
+			unique_lock<mutex> lock(_mutex);
+			_task = [&](Machine& cmp, size_t index) {
+				auto valid = false;
+				try {
+					results[index] = runner(cmp, jobs[index]);
+					valid = true;
+				}
+				catch (const std::exception&) { }
+				catch (const std::exception* e) {
+					delete e; // Computer throws by pointer
+				}
+				catch (...) { }
+				if (!valid) {
+					results[index] = get_invalid_result(cmp, jobs[index]);
+				}
+			};
+			_busy = _threads;
+			_generation++;
+			_started.notify_all();
+			_finished.wait(lock, [&] { return _busy == 0; });
+			_task = nullptr;
+			return results;
+		}
+
+	private:
+		const size_t                          _threads;
+		vector<unique_ptr<Machine>>           _pool;
+		vector<unique_ptr<Worker>>            _workers;
+		vector<thread>                        _worker_threads;
+		mutex                                 _run_mutex;
+		mutex                                 _mutex;      // guards fields below
+		condition_variable                    _started;    // new generation or stop
+		condition_variable                    _finished;   // all workers are idle
+		function<void(Machine&, size_t)>      _task;
+		size_t                                _generation = 0;
+		size_t                                _busy       = 0;
+		bool                                  _stopped    = false;
+
+		void work_loop(size_t self) {
+			auto& cmp = *_pool[self];
+			size_t generation = 0;
+			while (true) {
+				{
+					unique_lock<mutex> lock(_mutex);
+					_started.wait(lock, [&] { return _stopped || (_generation != generation); });
+					if (_stopped) {
+						return;
+					}
+					generation = _generation;
+				}
+				// Task is set before generation is published and reset only after all workers finish
+				size_t index = 0;
+				while (take_job(self, index)) {
+					_task(cmp, index);
+				}
+				lock_guard<mutex> lock(_mutex);
+				if (--_busy == 0) {
+					_finished.notify_one();
+				}
+			}
+		}
+
+		bool take_job(size_t self, size_t& index) {
+			{
+				auto& own = *_workers[self];
+				lock_guard<mutex> lock(own.Mutex);
+				if (!own.Jobs.empty()) {
+					index = own.Jobs.front();
+					own.Jobs.pop_front();
+					return true;
+				}
+			}
+			for (size_t i = 1; i < _workers.size(); i++) {
+				auto& victim = *_workers[(self + i) % _workers.size()];
+				lock_guard<mutex> lock(victim.Mutex);
+				if (!victim.Jobs.empty()) {
+					index = victim.Jobs.back();
+					victim.Jobs.pop_back();
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+}
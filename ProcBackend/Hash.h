@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Utils {
+	const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+	const uint64_t FNV_PRIME  = 0x100000001b3ULL;
+
+	// FNV-1a, 64 bit
+	uint64_t hash_bytes(const uint8_t* data, size_t size, uint64_t hash = FNV_OFFSET) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	uint64_t hash_value(uint64_t value, uint64_t hash = FNV_OFFSET) {
+		for (size_t i = 0; i < sizeof(value); i++) {
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+}
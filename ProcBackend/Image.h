@@ -0,0 +1,235 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+
+#include "Hash.h"
+#include "Computer.h"
+#include "MappedFile.h"
+#include "Architecture.h"
+
+using std::tuple;
+using std::string;
+using std::ostream;
+
+using Core::Computer;
+using Utils::MappedFile;
+using Architecture::Word;
+using Architecture::WordSet;
+using Architecture::WORD_SIZE;
+using Architecture::WORD_BYTES;
+
+namespace Images {
+	// Binary image layout, all numbers are little-endian:
+	//  0 char[4] magic "CPIM"
+	//  4 uint16  format version
+	//  6 uint16  word size in bits
+	//  8 uint32  RAM size in words
+	// 12 uint32  CPU memory size in words (initial registers)
+	// 16 uint32  entry IP
+	// 20 uint32  reserved (0)
+	// 24 uint64  checksum of payload (FNV-1a)
+	// 32 payload: CPU memory words, then RAM words, WORD_BYTES bytes per word
+	const char     MAGIC[4]    = { 'C', 'P', 'I', 'M' };
+	const uint16_t VERSION     = 1;
+	const size_t   HEADER_SIZE = 32;
+
+	template<size_t IMS, size_t RMS>
+	class Image {
+	public:
+		WordSet<IMS> Registers = { };
+		WordSet<RMS> Ram       = { };
+		size_t       EntryIP   = 0;
+
+		// Writes initial registers and entry IP to the computer built from Ram
+		template<class P, class RP>
+		void apply(Computer<IMS, RMS, P, RP>& cmp) const {
+			auto& cpu = cmp.State.CPU;
+			for (size_t i = 0; i < IMS; i++) {
+				cpu.set_bits(cmp.Registers.get_register(i), Registers[i]);
+			}
+			if (EntryIP != 0) {
+				cpu.set_bits(cmp.Registers.IP, Word(EntryIP));
+			}
+		}
+	};
+
+	template<class T>
+	T read_le(const uint8_t* data, size_t size = sizeof(T)) {
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; i++) {
+			value |= uint64_t(data[i]) << (i * 8);
+		}
+		return static_cast<T>(value);
+	}
+
+	template<class T>
+	void write_le(ostream& os, T value, size_t size = sizeof(T)) {
+		auto raw = static_cast<uint64_t>(value);
+		for (size_t i = 0; i < size; i++) {
+			os.put(static_cast<char>((raw >> (i * 8)) & 0xFF));
+		}
+	}
+
+	// Text format: '0' and '1' characters, most significant bit first,
+	// WORD_SIZE digits form a word, any other characters are ignored.
+	// Input is classified 8 bytes at a time, whole-digit blocks are packed with one multiply.
+	// Chunks are read as little-endian so byte k is always at bits 8k..8k+7 regardless of host order.
+	// Returns count of parsed words.
+	template<size_t RMS>
+	size_t parse_text(const uint8_t* data, size_t size, WordSet<RMS>& ram) {
+		const uint64_t ZEROS = 0x3030303030303030ULL; // '0' in every byte
+		const uint64_t LOWS  = 0x0101010101010101ULL;
+		const uint64_t HIGHS = 0x7F7F7F7F7F7F7F7FULL;
+		const uint64_t PACK  = 0x8040201008040201ULL; // byte k lsb => bit (7 - k) of top byte
+
+		size_t   words = 0;
+		size_t   digits = 0;
+		uint64_t value = 0;
+		auto push_bits = [&](uint64_t bits, size_t count) {
+			while (count > 0) {
+				auto take = std::min(count, WORD_SIZE - digits);
+				count -= take;
+				value = (value << take) | ((bits >> count) & ((uint64_t(1) << take) - 1));
+				digits += take;
+				if (digits == WORD_SIZE) {
+					ram[words++] = Word(value);
+					value = 0;
+					digits = 0;
+					if (words == RMS) {
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			auto chunk = read_le<uint64_t>(data + i);
+			auto t = (chunk ^ ZEROS) & ~LOWS;                 // zero bytes are '0' or '1'
+			auto non_digits = ((t & HIGHS) + HIGHS) | t;     // high bit set for non-digit bytes
+			if ((non_digits & ~HIGHS) == ~HIGHS) {
+				continue; // no digits
+			}
+			auto lsbs = (chunk ^ ZEROS) & LOWS;
+			if ((non_digits & ~HIGHS) == 0) {
+				if (!push_bits((lsbs * PACK) >> 56, 8)) {
+					return words;
+				}
+				continue;
+			}
+			for (size_t k = 0; k < 8; k++) {
+				if (((non_digits >> (k * 8 + 7)) & 1) == 0) {
+					if (!push_bits((lsbs >> (k * 8)) & 1, 1)) {
+						return words;
+					}
+				}
+			}
+		}
+		for (; i < size; i++) {
+			auto c = data[i];
+			if ((c == '0') || (c == '1')) {
+				if (!push_bits(c - '0', 1)) {
+					return words;
+				}
+			}
+		}
+		return words;
+	}
+
+	template<size_t IMS, size_t RMS>
+	void write_binary(ostream& os, const Image<IMS, RMS>& image) {
+		std::ostringstream payload;
+		for (const auto& word : image.Registers) {
+			write_le(payload, word.to_ullong(), WORD_BYTES);
+		}
+		for (const auto& word : image.Ram) {
+			write_le(payload, word.to_ullong(), WORD_BYTES);
+		}
+		auto bytes = payload.str();
+		auto checksum = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+
+		os.write(MAGIC, sizeof(MAGIC));
+		write_le<uint16_t>(os, VERSION);
+		write_le<uint16_t>(os, WORD_SIZE);
+		write_le<uint32_t>(os, RMS);
+		write_le<uint32_t>(os, IMS);
+		write_le<uint32_t>(os, image.EntryIP);
+		write_le<uint32_t>(os, 0);
+		write_le<uint64_t>(os, checksum);
+		os.write(bytes.data(), bytes.size());
+	}
+
+	bool is_binary(const uint8_t* data, size_t size) {
+		return (size >= HEADER_SIZE) && (std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0);
+	}
+
+	// Images with fewer registers or RAM words than IMS/RMS are zero-extended
+	template<size_t IMS, size_t RMS>
+	tuple<bool, string> parse_binary(const uint8_t* data, size_t size, Image<IMS, RMS>& image) {
+		if (!is_binary(data, size)) {
+			return { false, "not a binary image" };
+		}
+		auto version   = read_le<uint16_t>(data + 4);
+		auto word_size = read_le<uint16_t>(data + 6);
+		auto ram_size  = read_le<uint32_t>(data + 8);
+		auto cpu_size  = read_le<uint32_t>(data + 12);
+		auto entry_ip  = read_le<uint32_t>(data + 16);
+		auto checksum  = read_le<uint64_t>(data + 24);
+		if (version != VERSION) {
+			return { false, "unsupported version " + std::to_string(version) };
+		}
+		if (word_size != WORD_SIZE) {
+			return { false, "word size " + std::to_string(word_size) + " != " + std::to_string(WORD_SIZE) };
+		}
+		if ((ram_size > RMS) || (cpu_size > IMS)) {
+			return { false, "image does not fit into memory" };
+		}
+		if (entry_ip >= RMS) {
+			return { false, "entry IP " + std::to_string(entry_ip) + " is out of RAM" };
+		}
+		auto payload_size = (size_t(cpu_size) + ram_size) * WORD_BYTES;
+		if (size < HEADER_SIZE + payload_size) {
+			return { false, "image is truncated" };
+		}
+		auto payload = data + HEADER_SIZE;
+		if (Utils::hash_bytes(payload, payload_size) != checksum) {
+			return { false, "checksum mismatch" };
+		}
+		image = Image<IMS, RMS>();
+		for (size_t i = 0; i < cpu_size; i++, payload += WORD_BYTES) {
+			image.Registers[i] = Word(read_le<uint64_t>(payload, WORD_BYTES));
+		}
+		for (size_t i = 0; i < ram_size; i++, payload += WORD_BYTES) {
+			image.Ram[i] = Word(read_le<uint64_t>(payload, WORD_BYTES));
+		}
+		image.EntryIP = entry_ip;
+		return { true, "" };
+	}
+
+	template<size_t IMS, size_t RMS>
+	tuple<bool, string> parse(const uint8_t* data, size_t size, Image<IMS, RMS>& image) {
+		if (is_binary(data, size)) {
+			return parse_binary(data, size, image);
+		}
+		image = Image<IMS, RMS>();
+		parse_text(data, size, image.Ram);
+		return { true, "" };
+	}
+
+	// Detects format by magic, binary and text images are both accepted
+	template<size_t IMS, size_t RMS>
+	tuple<bool, string> load(const string& path, Image<IMS, RMS>& image) {
+		auto file = MappedFile(path);
+		if (!file.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		file.advise_sequential();
+		return parse(file.data(), file.size(), image);
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <condition_variable>
+
+#include "Image.h"
+#include "BoundedQueue.h"
+
+using std::mutex;
+using std::tuple;
+using std::atomic;
+using std::string;
+using std::thread;
+using std::vector;
+using std::unique_lock;
+using std::condition_variable;
+
+using Images::Image;
+using Utils::BoundedQueue;
+
+namespace Images {
+	// Directory: all regular files in it, sorted by name
+	// File: manifest with one image path per line, relative to manifest directory,
+	//       empty lines and lines starting with '#' are skipped
+	tuple<bool, string> list_sources(const string& path, vector<string>& result) {
+		namespace fs = std::filesystem;
+		result.clear();
+		std::error_code ec;
+		if (fs::is_directory(path, ec)) {
+			for (const auto& entry : fs::directory_iterator(path, ec)) {
+				if (entry.is_regular_file(ec)) {
+					result.push_back(entry.path().string());
+				}
+			}
+			std::sort(result.begin(), result.end());
+		} else {
+			auto base = fs::path(path).parent_path();
+			auto f = std::ifstream(path);
+			if (!f) {
+				return { false, "can't open sources: " + path };
+			}
+			string line;
+			while (std::getline(f, line)) {
+				if (!line.empty() && (line.back() == '\r')) {
+					line.pop_back();
+				}
+				if (line.empty() || (line[0] == '#')) {
+					continue;
+				}
+				auto image_path = fs::path(line);
+				result.push_back((image_path.is_absolute() ? image_path : base / image_path).string());
+			}
+		}
+		if (ec) {
+			return { false, "can't list sources: " + path + ": " + ec.message() };
+		}
+		return { true, "" };
+	}
+
+	// Reads and parses images on background threads with bounded prefetch:
+	// readers claim next path, load it and hand result to consumer through lock-free queue.
+	// When queue is full readers block, so at most (capacity + readers) images are in memory.
+	// Both sides sleep on condition variables, the mutex is taken only to wait and to notify.
+	// Items may arrive out of order, Index is position in source list.
+	template<size_t IMS, size_t RMS>
+	class Ingestion {
+	public:
+		class Item {
+		public:
+			size_t          Index = 0;
+			string          Path;
+			bool            Ok    = false;
+			string          Error;
+			Image<IMS, RMS> Value;
+		};
+
+		Ingestion(const vector<string>& paths, size_t readers = 2, size_t capacity = 64):
+			_paths(paths), _queue(capacity) {
+			readers = std::max<size_t>(1, std::min(readers, paths.size()));
+			for (size_t i = 0; i < readers; i++) {
+				_readers.emplace_back(&Ingestion::read_loop, this);
+			}
+		}
+
+		Ingestion(const Ingestion&) = delete;
+		Ingestion& operator=(const Ingestion&) = delete;
+
+		~Ingestion() {
+			{
+				std::lock_guard<mutex> lock(_mutex);
+				_stopped = true;
+			}
+			_space.notify_all();
+			for (auto& reader : _readers) {
+				reader.join();
+			}
+		}
+
+		size_t size() const {
+			return _paths.size();
+		}
+
+		// Waits for next ready image, returns false when all images are consumed
+		bool pop(Item& item) {
+			if (_popped == _paths.size()) {
+				return false;
+			}
+			if (!_queue.try_pop(item)) {
+				unique_lock<mutex> lock(_mutex);
+				_ready.wait(lock, [&] { return _queue.try_pop(item); });
+			}
+			_popped++;
+			notify(_space);
+			return true;
+		}
+
+	private:
+		const vector<string> _paths;
+		BoundedQueue<Item>   _queue;
+		atomic<size_t>       _next    = { 0 };
+		atomic<size_t>       _popped  = { 0 };
+		atomic<bool>         _stopped = { false };
+		mutex                _mutex;
+		condition_variable   _ready; // queue got an item
+		condition_variable   _space; // queue got a free cell or ingestion is stopped
+		vector<thread>       _readers;
+
+		// Taking the mutex orders notification after waiter's failed check, so wakeups are not lost
+		void notify(condition_variable& cv) {
+			{
+				std::lock_guard<mutex> lock(_mutex);
+			}
+			cv.notify_one();
+		}
+
+		void read_loop() {
+			while (!_stopped) {
+				auto index = _next++;
+				if (index >= _paths.size()) {
+					return;
+				}
+				Item item;
+				item.Index = index;
+				item.Path  = _paths[index];
+				auto [ok, error] = Images::load(item.Path, item.Value);
+				item.Ok    = ok;
+				item.Error = error;
+				if (!_queue.try_push(item)) {
+					unique_lock<mutex> lock(_mutex);
+					_space.wait(lock, [&] { return _stopped || _queue.try_push(item); });
+					if (_stopped) {
+						return;
+					}
+				}
+				notify(_ready);
+			}
+		}
+	};
+}
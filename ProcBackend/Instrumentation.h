@@ -0,0 +1,360 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+
+#include "WordRunner.h"
+#include "CpuCommands.h"
+#include "Architecture.h"
+
+using std::array;
+using std::vector;
+using std::ostream;
+
+namespace Instrumentation {
+	// Probe policy used by default: all hooks are empty and
+	// every call site is guarded by 'if constexpr (Enabled)'
+	class NoProbe {
+	public:
+		static constexpr bool Enabled = false;
+
+		void begin_tick(bool) {}
+		void on_ram_read(size_t) {}
+		void on_ram_write(size_t) {}
+		void on_execute(size_t, size_t, bool) {}
+	};
+
+	// Combines several probes into one policy, hooks are called in declaration order
+	template<class ...Probes>
+	class ProbeSet : public Probes... {
+	public:
+		static constexpr bool Enabled = (Probes::Enabled || ...);
+
+		template<class P>
+		P& get() {
+			return *this;
+		}
+
+		template<class P>
+		const P& get() const {
+			return *this;
+		}
+
+		void begin_tick(bool is_fetch) {
+			(Probes::begin_tick(is_fetch), ...);
+		}
+
+		void on_ram_read(size_t address) {
+			(Probes::on_ram_read(address), ...);
+		}
+
+		void on_ram_write(size_t address) {
+			(Probes::on_ram_write(address), ...);
+		}
+
+		void on_execute(size_t ip, size_t code, bool zero) {
+			(Probes::on_execute(ip, code, zero), ...);
+		}
+	};
+
+	// Counts executed instructions (each command once, even if it takes two execute steps)
+	class InstructionCounter {
+	public:
+		static constexpr bool Enabled = true;
+
+		uint64_t Executed = 0;
+
+		void begin_tick(bool) {}
+		void on_ram_read(size_t) {}
+		void on_ram_write(size_t) {}
+
+		void on_execute(size_t, size_t, bool) {
+			Executed++;
+		}
+	};
+
+	// Per-address RAM access counters
+	// Fetch - read of command code or argument (pipeline states Decode, Read 1, Read 2)
+	// Read  - data read (LD, LDA)
+	// Write - data write (ST, STA)
+	template<size_t RMS>
+	class AccessHeatmap {
+	public:
+		static constexpr bool Enabled = true;
+
+		static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+		class Region {
+		public:
+			size_t First;
+			size_t Last;
+			bool   Written;
+		};
+
+		class WorkingSet {
+		public:
+			size_t         Touched     = 0;
+			size_t         ReadOnly    = 0;
+			size_t         Written     = 0;
+			uint64_t       FirstTick   = NEVER;
+			uint64_t       LastTick    = 0;
+			vector<Region> Regions;
+		};
+
+		array<uint32_t, RMS> Reads     = { 0 };
+		array<uint32_t, RMS> Writes    = { 0 };
+		array<uint32_t, RMS> Fetches   = { 0 };
+		array<uint64_t, RMS> FirstTick = make_never();
+		array<uint64_t, RMS> LastTick  = { 0 };
+
+		void begin_tick(bool is_fetch) {
+			_tick++;
+			_is_fetch = is_fetch;
+		}
+
+		void on_ram_read(size_t address) {
+			if (address >= RMS) {
+				return;
+			}
+			if (_is_fetch) {
+				Fetches[address]++;
+			} else {
+				Reads[address]++;
+			}
+			touch(address);
+		}
+
+		void on_ram_write(size_t address) {
+			if (address >= RMS) {
+				return;
+			}
+			Writes[address]++;
+			touch(address);
+		}
+
+		void on_execute(size_t, size_t, bool) {}
+
+		bool is_touched(size_t address) const {
+			return FirstTick[address] != NEVER;
+		}
+
+		uint64_t get_ticks() const {
+			return _tick;
+		}
+
+		WorkingSet get_working_set() const {
+			WorkingSet ws;
+			for (size_t i = 0; i < RMS; i++) {
+				if (!is_touched(i)) {
+					continue;
+				}
+				auto written = Writes[i] > 0;
+				ws.Touched++;
+				(written ? ws.Written : ws.ReadOnly)++;
+				ws.FirstTick = std::min(ws.FirstTick, FirstTick[i]);
+				ws.LastTick  = std::max(ws.LastTick, LastTick[i]);
+				auto& regions = ws.Regions;
+				if (!regions.empty() && (regions.back().Last + 1 == i) && (regions.back().Written == written)) {
+					regions.back().Last = i;
+				} else {
+					regions.push_back({ i, i, written });
+				}
+			}
+			return ws;
+		}
+
+		// One line per touched address: address,fetches,reads,writes,first_tick,last_tick
+		void write_csv(ostream& os) const {
+			os << "address,fetches,reads,writes,first_tick,last_tick\n";
+			for (size_t i = 0; i < RMS; i++) {
+				if (is_touched(i)) {
+					os << i << "," << Fetches[i] << "," << Reads[i] << "," << Writes[i] << ",";
+					os << FirstTick[i] << "," << LastTick[i] << "\n";
+				}
+			}
+		}
+
+		void write_report(ostream& os) const {
+			auto ws = get_working_set();
+			os << "Working set: " << ws.Touched << "/" << RMS << " words";
+			os << " (read-only: " << ws.ReadOnly << ", written: " << ws.Written << ")\n";
+			if (ws.Touched > 0) {
+				os << "Ticks: " << ws.FirstTick << ".." << ws.LastTick << "\n";
+			}
+			for (const auto& r : ws.Regions) {
+				os << "  [" << r.First << ".." << r.Last << "] " << (r.Written ? "written" : "read-only") << "\n";
+			}
+		}
+
+	private:
+		uint64_t _tick     = 0;
+		bool     _is_fetch = false;
+
+		static array<uint64_t, RMS> make_never() {
+			array<uint64_t, RMS> result;
+			result.fill(NEVER);
+			return result;
+		}
+
+		void touch(size_t address) {
+			if (FirstTick[address] == NEVER) {
+				FirstTick[address] = _tick;
+			}
+			LastTick[address] = _tick;
+		}
+	};
+
+	// Executed-address coverage, one bit per RAM address,
+	// plus executed command codes and JZ taken/not taken per address.
+	// Codes without a command share one extra bit after the known ones
+	template<size_t RMS>
+	class Coverage {
+		using Bitmap = vector<uint64_t>;
+
+		static constexpr size_t INVALID_COMMAND = Logics::WordLayout::COMMAND_COUNT;
+
+	public:
+		static constexpr bool Enabled = true;
+
+		void begin_tick(bool) {}
+		void on_ram_read(size_t) {}
+		void on_ram_write(size_t) {}
+
+		void on_execute(size_t ip, size_t code, bool zero) {
+			mark(_addresses, ip);
+			mark(_commands, std::min(code, INVALID_COMMAND));
+			if (code == Logics::Command::JZ) {
+				mark(zero ? _jz_taken : _jz_not_taken, ip);
+			}
+		}
+
+		bool is_executed(size_t address) const {
+			return test(_addresses, address);
+		}
+
+		bool is_command_executed(size_t code) const {
+			return (code < INVALID_COMMAND) && test(_commands, code);
+		}
+
+		bool is_invalid_command_executed() const {
+			return test(_commands, INVALID_COMMAND);
+		}
+
+		bool is_jz_taken(size_t address) const {
+			return test(_jz_taken, address);
+		}
+
+		bool is_jz_not_taken(size_t address) const {
+			return test(_jz_not_taken, address);
+		}
+
+		size_t count_addresses() const {
+			return count(_addresses);
+		}
+
+		size_t count_commands() const {
+			return count(_commands) - (is_invalid_command_executed() ? 1 : 0);
+		}
+
+		// Is there any bit which is not covered by given total yet
+		bool has_new(const Coverage& total) const {
+			return has_new(_addresses, total._addresses) || has_new(_commands, total._commands) ||
+				has_new(_jz_taken, total._jz_taken) || has_new(_jz_not_taken, total._jz_not_taken);
+		}
+
+		void merge(const Coverage& other) {
+			merge(_addresses, other._addresses);
+			merge(_commands, other._commands);
+			merge(_jz_taken, other._jz_taken);
+			merge(_jz_not_taken, other._jz_not_taken);
+		}
+
+		// Text format, one bitmap per line as 64-bit hex words (lowest address first):
+		// addresses <words>
+		// commands <words>
+		// jz_taken <words>
+		// jz_not_taken <words>
+		void write(ostream& os) const {
+			write_line(os, "addresses", _addresses);
+			write_line(os, "commands", _commands);
+			write_line(os, "jz_taken", _jz_taken);
+			write_line(os, "jz_not_taken", _jz_not_taken);
+		}
+
+		bool read(std::istream& is) {
+			return read_line(is, "addresses", _addresses) && read_line(is, "commands", _commands) &&
+				read_line(is, "jz_taken", _jz_taken) && read_line(is, "jz_not_taken", _jz_not_taken);
+		}
+
+	private:
+		Bitmap _addresses    = make_bitmap(RMS);
+		Bitmap _commands     = make_bitmap(INVALID_COMMAND + 1);
+		Bitmap _jz_taken     = make_bitmap(RMS);
+		Bitmap _jz_not_taken = make_bitmap(RMS);
+
+		static Bitmap make_bitmap(size_t bits) {
+			return Bitmap((bits + 63) / 64, 0);
+		}
+
+		static void mark(Bitmap& bitmap, size_t index) {
+			if (index < bitmap.size() * 64) {
+				bitmap[index >> 6] |= uint64_t(1) << (index & 63);
+			}
+		}
+
+		static bool test(const Bitmap& bitmap, size_t index) {
+			return (index < bitmap.size() * 64) && ((bitmap[index >> 6] >> (index & 63)) & 1);
+		}
+
+		static size_t count(const Bitmap& bitmap) {
+			size_t result = 0;
+			for (auto word : bitmap) {
+				result += std::bitset<64>(word).count();
+			}
+			return result;
+		}
+
+		static bool has_new(const Bitmap& bitmap, const Bitmap& total) {
+			for (size_t i = 0; i < bitmap.size(); i++) {
+				if (bitmap[i] & ~total[i]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static void merge(Bitmap& bitmap, const Bitmap& other) {
+			for (size_t i = 0; i < bitmap.size(); i++) {
+				bitmap[i] |= other[i];
+			}
+		}
+
+		static void write_line(ostream& os, const char* name, const Bitmap& bitmap) {
+			os << name << std::hex;
+			for (auto word : bitmap) {
+				os << " " << word;
+			}
+			os << std::dec << "\n";
+		}
+
+		static bool read_line(std::istream& is, const char* name, Bitmap& bitmap) {
+			std::string actual_name;
+			if (!(is >> actual_name) || (actual_name != name)) {
+				return false;
+			}
+			is >> std::hex;
+			for (auto& word : bitmap) {
+				is >> word;
+			}
+			is >> std::dec;
+			return !is.fail();
+		}
+	};
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <new>
+#include <array>
+#include <tuple>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::array;
+using std::tuple;
+using std::atomic;
+using std::string;
+
+namespace LiveState {
+	const uint32_t MAGIC         = 0x534C5043; // "CPLS"
+	const uint32_t VERSION       = 1;
+	const size_t   MAX_CPU_WORDS = 64;
+
+	enum class Status : uint32_t {
+		Running    = 0,
+		Terminated = 1,
+		Fatal      = 2,
+		Stopped    = 3, // run ended before the machine terminated, e.g. by a tick limit
+	};
+
+	// Published state of one machine, the layout is fixed so other processes can map it
+	// (all fields are naturally aligned, numbers are in host byte order):
+	//   0 uint32 magic "CPLS"
+	//   4 uint32 layout version
+	//   8 uint32 sequence, odd while the writer updates the frame
+	//  12 uint32 CPU words used (IMS, at most MAX_CPU_WORDS)
+	//  16 uint64 ticks
+	//  24 uint32 status
+	//  28 uint32 control bus, 32 address bus, 36 data bus
+	//  40 uint32 CPU words [MAX_CPU_WORDS]: SS, CC, A1, A2, FS, CR (counter), IP, AR, common registers
+	class Frame {
+	public:
+		uint32_t         Magic    = MAGIC;
+		uint32_t         Version  = VERSION;
+		atomic<uint32_t> Sequence = { 0 };
+		atomic<uint32_t> CpuWords = { 0 };
+		atomic<uint64_t> Ticks    = { 0 };
+		atomic<uint32_t> State    = { uint32_t(Status::Running) };
+		atomic<uint32_t> Buses[3] = { };
+		atomic<uint32_t> Cpu[MAX_CPU_WORDS] = { };
+	};
+
+	static_assert(atomic<uint32_t>::is_always_lock_free && atomic<uint64_t>::is_always_lock_free);
+	static_assert(sizeof(Frame) == 40 + 4 * MAX_CPU_WORDS);
+
+	// Consistent copy of a frame
+	class Sample {
+	public:
+		uint64_t                       Ticks    = 0;
+		Status                         State    = Status::Running;
+		uint32_t                       CpuWords = 0;
+		array<uint32_t, 3>             Buses    = { };
+		array<uint32_t, MAX_CPU_WORDS> Cpu      = { };
+		uint64_t                       Retries  = 0; // reads repeated because the writer was updating
+	};
+
+	// Seqlock writer: the execution thread never waits, readers retry when they see
+	// the sequence changed while they were copying. Fields are relaxed atomics,
+	// ordering is given by the fences around them.
+	class Writer {
+	public:
+		Writer(Frame& frame): _frame(frame) { }
+
+		// Final publication of a run passes stopped, so readers don't wait for a machine nobody runs
+		template<class Machine>
+		void publish(const Machine& machine, uint64_t ticks, bool stopped = false) {
+			static_assert(Machine::CpuSize <= MAX_CPU_WORDS);
+			using namespace Logics::WordLayout;
+			const auto& state = machine.State;
+			auto fs = state.CPU.peek(FS);
+			auto status = (fs & FT_BIT) ? Status::Fatal : ((fs & TR_BIT) ? Status::Terminated : Status::Running);
+			if (stopped && (status == Status::Running)) {
+				status = Status::Stopped;
+			}
+
+			auto sequence = _frame.Sequence.load(std::memory_order_relaxed);
+			_frame.Sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			_frame.CpuWords.store(uint32_t(Machine::CpuSize), std::memory_order_relaxed);
+			_frame.Ticks.store(ticks, std::memory_order_relaxed);
+			_frame.State.store(uint32_t(status), std::memory_order_relaxed);
+			_frame.Buses[0].store(uint32_t(state.ControlBus.peek(0)), std::memory_order_relaxed);
+			_frame.Buses[1].store(uint32_t(state.AddressBus.peek(0)), std::memory_order_relaxed);
+			_frame.Buses[2].store(uint32_t(state.DataBus.peek(0)), std::memory_order_relaxed);
+			for (size_t i = 0; i < Machine::CpuSize; i++) {
+				_frame.Cpu[i].store(uint32_t(state.CPU.peek(i)), std::memory_order_relaxed);
+			}
+
+			_frame.Sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+	private:
+		Frame& _frame;
+	};
+
+	// Returns false when no consistent copy was made in max_tries attempts
+	bool read(const Frame& frame, Sample& sample, size_t max_tries = 1000) {
+		sample.Retries = 0;
+		for (size_t i = 0; i < max_tries; i++) {
+			auto before = frame.Sequence.load(std::memory_order_acquire);
+			if ((before & 1) == 0) {
+				sample.CpuWords = std::min<uint32_t>(frame.CpuWords.load(std::memory_order_relaxed), MAX_CPU_WORDS);
+				sample.Ticks    = frame.Ticks.load(std::memory_order_relaxed);
+				sample.State    = Status(frame.State.load(std::memory_order_relaxed));
+				for (size_t j = 0; j < sample.Buses.size(); j++) {
+					sample.Buses[j] = frame.Buses[j].load(std::memory_order_relaxed);
+				}
+				for (size_t j = 0; j < sample.CpuWords; j++) {
+					sample.Cpu[j] = frame.Cpu[j].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (frame.Sequence.load(std::memory_order_relaxed) == before) {
+					return true;
+				}
+			}
+			sample.Retries++;
+		}
+		return false;
+	}
+
+	// Frame in a named POSIX shared memory segment ("/name"),
+	// created (and removed on destruction) by the writer, opened read-only by monitors.
+	// Not supported on Windows.
+	class SharedFrame {
+	public:
+		SharedFrame() = default;
+		SharedFrame(const SharedFrame&) = delete;
+		SharedFrame& operator=(const SharedFrame&) = delete;
+
+		~SharedFrame() {
+		#ifndef _WIN32
+			if (_frame != nullptr) {
+				::munmap(_frame, sizeof(Frame));
+			}
+			if (_owner) {
+				::shm_unlink(_name.c_str());
+			}
+		#endif
+		}
+
+		tuple<bool, string> create(const string& name) {
+		#ifdef _WIN32
+			return { false, "shared memory is not supported" };
+		#else
+			auto fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+			if (fd < 0) {
+				return { false, "can't create shared memory: " + name };
+			}
+			auto ok = ::ftruncate(fd, sizeof(Frame)) == 0;
+			auto addr = ok ? ::mmap(nullptr, sizeof(Frame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+			::close(fd);
+			if (addr == MAP_FAILED) {
+				::shm_unlink(name.c_str());
+				return { false, "can't map shared memory: " + name };
+			}
+			_frame = new (addr) Frame();
+			_name  = name;
+			_owner = true;
+			return { true, "" };
+		#endif
+		}
+
+		tuple<bool, string> open(const string& name) {
+		#ifdef _WIN32
+			return { false, "shared memory is not supported" };
+		#else
+			auto fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0) {
+				return { false, "can't open shared memory: " + name };
+			}
+			struct stat st;
+			auto ok = (::fstat(fd, &st) == 0) && (size_t(st.st_size) >= sizeof(Frame));
+			auto addr = ok ? ::mmap(nullptr, sizeof(Frame), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+			::close(fd);
+			if (addr == MAP_FAILED) {
+				return { false, "can't map shared memory: " + name };
+			}
+			_frame = static_cast<Frame*>(addr);
+			if ((_frame->Magic != MAGIC) || (_frame->Version != VERSION)) {
+				return { false, "unknown frame layout in " + name };
+			}
+			return { true, "" };
+		#endif
+		}
+
+		Frame* get() const {
+			return _frame;
+		}
+
+	private:
+		Frame* _frame = nullptr;
+		string _name;
+		bool   _owner = false;
+	};
+}
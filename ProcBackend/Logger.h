@@ -2,12 +2,14 @@
 
 #include <set>
 #include <string>
+#include <ostream>
 #include <iostream>
 
 using std::set;
 using std::cout;
 using std::endl;
 using std::string;
+using std::ostream;
 
 namespace Utils {
 	enum class LogType {
@@ -22,7 +24,14 @@ namespace Utils {
 	LogType _first_log_type = LogType::Computer;
 	LogType _last_log_type  = LogType::MemoryState;
 	
-	set<LogType> _enabled_types;
+	// Log settings and output are per thread, so machines run by other threads
+	// (e.g. tests run in parallel) do not mix their logs
+	thread_local set<LogType> _enabled_types;
+	thread_local ostream*     _log_output = &cout;
+
+	void set_log_output(ostream& os) {
+		_log_output = &os;
+	}
 
 	void enable_log(LogType type) {
 		_enabled_types.emplace(type);
@@ -42,23 +51,24 @@ namespace Utils {
 	template<class T>
 	void log(LogType type, const T& msg) {
 		if (_enabled_types.count(type) > 0) {
-			cout << " + " << msg;
+			*_log_output << " + " << msg;
 		}
 	}
 
 	template<class ...Args>
 	void log_line(LogType type, Args&&... args) {
 		if (_enabled_types.count(type) > 0) {
-			cout << " + ";
+			auto& os = *_log_output;
+			os << " + ";
 		#ifdef __clang__
 			#pragma clang diagnostic push
 			#pragma clang diagnostic ignored "-Wunused-value"
 		#endif
-			(cout << ... << args);
+			(os << ... << args);
 		#ifdef __clang__
 			#pragma clang diagnostic pop
 		#endif
-			cout << endl;
+			os << endl;
 		}
 	}
 }
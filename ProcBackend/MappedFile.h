@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#ifdef _WIN32
+	#include <fstream>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace Utils {
+	// View of whole file contents
+	// POSIX: private mmap, pages are loaded on first access
+	// Windows: file is read into memory
+	// writable: contents may be changed in memory (pages are copied on write), never in the file
+	class MappedFile {
+	public:
+		MappedFile(const string& path, bool writable = false) {
+		#ifdef _WIN32
+			auto f = std::ifstream(path, std::ios::binary | std::ios::in | std::ios::ate);
+			if (!f.is_open()) {
+				return;
+			}
+			_buffer.resize(static_cast<size_t>(f.tellg()));
+			f.seekg(0);
+			f.read(reinterpret_cast<char*>(_buffer.data()), _buffer.size());
+			_data     = _buffer.data();
+			_size     = _buffer.size();
+			_opened   = !f.fail();
+			_writable = writable;
+		#else
+			auto fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+			struct stat st;
+			if (::fstat(fd, &st) == 0) {
+				_size   = static_cast<size_t>(st.st_size);
+				_opened = true;
+				if (_size > 0) {
+					auto protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+					auto addr = ::mmap(nullptr, _size, protection, MAP_PRIVATE, fd, 0);
+					if (addr != MAP_FAILED) {
+						_data     = static_cast<const uint8_t*>(addr);
+						_writable = writable;
+					} else {
+						_opened = false;
+					}
+				}
+			}
+			::close(fd);
+		#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile() {
+		#ifndef _WIN32
+			if (_data != nullptr) {
+				::munmap(const_cast<uint8_t*>(_data), _size);
+			}
+		#endif
+		}
+
+		bool is_open() const {
+			return _opened;
+		}
+
+		const uint8_t* data() const {
+			return _data;
+		}
+
+		// nullptr unless the file is opened as writable
+		uint8_t* mutable_data() const {
+			return _writable ? const_cast<uint8_t*>(_data) : nullptr;
+		}
+
+		size_t size() const {
+			return _size;
+		}
+
+		// Hint that file will be read from start to end
+		void advise_sequential() const {
+		#ifndef _WIN32
+			if (_data != nullptr) {
+				::madvise(const_cast<uint8_t*>(_data), _size, MADV_SEQUENTIAL);
+			}
+		#endif
+		}
+
+	private:
+		bool           _opened   = false;
+		bool           _writable = false;
+		const uint8_t* _data     = nullptr;
+		size_t         _size     = 0;
+	#ifdef _WIN32
+		vector<uint8_t> _buffer;
+	#endif
+	};
+}
@@ -1,44 +1,158 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <memory>
 #include <string>
+#include <algorithm>
+#include <type_traits>
 
 #include "Logger.h"
 #include "BitUtils.h"
 #include "Reference.h"
 #include "Architecture.h"
 
+using std::array;
 using std::bitset;
+using std::shared_ptr;
 using std::string_view;
 
 using Utils::LogType;
 using Core::Reference;
 using Architecture::WordSet;
 using Architecture::WORD_SIZE;
+using Architecture::NativeWord;
 
 namespace State {
-	template<size_t MS>
+	const size_t PAGE_WORDS  = 64; // copy-on-write granularity of memory states
+	const size_t TABLE_PAGES = 64; // pages per second level table of sparse memory states
+	// Control block of a shared_ptr allocation is at least use and weak counts and a vtable pointer,
+	// heap allocator headers are not known, so byte counts of pages are lower bounds
+	const size_t CONTROL_BLOCK_BYTES = 2 * sizeof(int) + sizeof(void*);
+
+	// Every page is allocated by construction, clear and load
+	class DensePaging {
+	public:
+		static constexpr bool Sparse = false;
+	};
+
+	// Pages never written are one shared read-only zero page, the page table has two levels
+	// and its parts without written pages are shared too, so construction and clear are O(1)
+	// and memory of a state follows the pages written to it
+	class SparsePaging {
+	public:
+		static constexpr bool Sparse = true;
+	};
+
+	// Pages of one or more states, a page is shared when more than one state can see it
+	class PageStats {
+	public:
+		size_t Pages        = 0;
+		size_t Shared       = 0;
+		size_t Private      = 0;
+		size_t PrivateBytes = 0; // memory owned only by these states, with control blocks (lower bound)
+
+		PageStats& operator+=(const PageStats& other) {
+			Pages        += other.Pages;
+			Shared       += other.Shared;
+			Private      += other.Private;
+			PrivateBytes += other.PrivateBytes;
+			return *this;
+		}
+	};
+
+	// Memory is kept as words in pages behind a shared page table,
+	// so copy of a state is O(1) and only written pages are copied (copy-on-write).
+	// Copies may be used from different threads, each copy from one thread at a time;
+	// a state must not be copied while another thread writes it.
+	// Writes decide by reference count whether a page is private (see is_private).
+	// Paging selects how pages are allocated, both kinds of states behave the same.
+	template<size_t MS, class Paging = DensePaging>
 	class MemoryState {
 		static_assert(MS > 0);
+		static_assert(WORD_SIZE <= 8 * sizeof(NativeWord));
+
 	public:
-		MemoryState(string name): _name(name) { }
+		static constexpr size_t PAGE_SIZE  = (MS < PAGE_WORDS) ? MS : PAGE_WORDS;
+		static constexpr size_t PAGE_COUNT = (MS + PAGE_SIZE - 1) / PAGE_SIZE;
+		static constexpr size_t PAGED_SIZE = PAGE_SIZE * PAGE_COUNT; // words including tail of last page
+
+	private:
+		static constexpr size_t TABLE_COUNT = (PAGE_COUNT + TABLE_PAGES - 1) / TABLE_PAGES;
 
-		MemoryState(string name, WordSet<MS> init_memory) :_name(name) {
-			for ( size_t i = 0; i < MS; i++ ) {
-				for ( size_t j = 0; j < Architecture::WORD_SIZE; j++ ) {
-					_memory[i * Architecture::WORD_SIZE + j] = init_memory[i][j];
+		using Page      = array<NativeWord, PAGE_SIZE>;
+		using PagePtr   = shared_ptr<Page>;
+		using Table     = array<PagePtr, TABLE_PAGES>; // second level of sparse page table
+		using PageTable = std::conditional_t<Paging::Sparse, array<shared_ptr<Table>, TABLE_COUNT>, array<PagePtr, PAGE_COUNT>>;
+		static_assert(sizeof(Page) == PAGE_SIZE * sizeof(NativeWord));
+
+	public:
+		MemoryState(const char* name): _name(name) {
+			clear();
+		}
+
+		MemoryState(const char* name, WordSet<MS> init_memory) :_name(name) {
+			load(init_memory);
+		}
+
+		void load(const WordSet<MS>& memory) {
+			if constexpr (Paging::Sparse) {
+				clear();
+				for (size_t i = 0; i < MS; i++) {
+					if (memory[i].any()) {
+						mutable_word(i) = static_cast<NativeWord>(memory[i].to_ulong());
+					}
+				}
+			} else {
+				make_private();
+				for ( size_t i = 0; i < MS; i++ ) {
+					word(i) = static_cast<NativeWord>(memory[i].to_ulong());
+				}
+			}
+		}
+
+		void clear() {
+			if constexpr (Paging::Sparse) {
+				_table = zero_table();
+			} else {
+				make_private();
+				for (auto& page : *_table) {
+					page->fill(0);
 				}
 			}
 		}
 
 		auto get_all() const {
-			return _memory;
+			bitset<MS * Architecture::WORD_SIZE> memory = { 0 };
+			for (size_t page = 0; page < PAGE_COUNT; page++) {
+				if (is_zero_page(page)) {
+					continue;
+				}
+				for (auto i = page * PAGE_SIZE; i < std::min(MS, (page + 1) * PAGE_SIZE); i++) {
+					auto value = word(i);
+					for (size_t j = 0; j < Architecture::WORD_SIZE; j++) {
+						memory[i * Architecture::WORD_SIZE + j] = (value >> j) & 1;
+					}
+				}
+			}
+			return memory;
 		}
 
 		template<size_t SZ>
 		void set_bits(Reference<SZ> ref, const bitset<SZ>& value) {
 			static_assert(SZ <= MS * WORD_SIZE);
-			BitUtils::set_bits<SZ, MS * WORD_SIZE>(_memory, ref.Address, value);
+			auto index  = ref.Address / WORD_SIZE;
+			auto offset = ref.Address % WORD_SIZE;
+			if (offset + SZ <= WORD_SIZE) {
+				auto mask = static_cast<NativeWord>(((uint64_t(1) << SZ) - 1) << offset);
+				auto& target = mutable_word(index);
+				target = static_cast<NativeWord>((target & ~mask) | ((value.to_ulong() << offset) & mask));
+			} else {
+				for (size_t i = 0; i < SZ; i++) {
+					set_bit(ref.Address + i, value[i]);
+				}
+			}
 			Utils::log_line(LogType::MemoryState, _name, ": W > ", ref, " = ", value);
 		}
 		
@@ -52,20 +166,243 @@ namespace State {
 			return get_bits(ref);
 		}
 
+		// Word value without logging, for observers which read state every tick
+		unsigned long peek(size_t index) const {
+			return word(index);
+		}
+
+		// Word write without logging, for engines which restore recorded state
+		void poke(size_t index, unsigned long value) {
+			mutable_word(index) = static_cast<NativeWord>(value);
+		}
+
+		// Uses PAGED_SIZE words owned by owner (e.g. a mapped file) as pages without copying them.
+		// Every page gets own control block which keeps owner alive, so a page is shared only
+		// after the state is copied and words are written in place until then: memory must be writable.
+		void map_pages(NativeWord* words, const shared_ptr<void>& owner) {
+			if constexpr (Paging::Sparse) {
+				_table = zero_table();
+			} else {
+				_table = std::make_shared<PageTable>();
+			}
+			for (size_t i = 0; i < PAGE_COUNT; i++) {
+				private_slot(i) = PagePtr(reinterpret_cast<Page*>(words + i * PAGE_SIZE), [owner](Page*) { });
+			}
+		}
+
+		// Pages of the zero page of sparse states are counted as shared
+		PageStats get_page_stats() const {
+			PageStats stats;
+			auto table_shared = _table.use_count() > 1;
+			auto count_page = [&](const PagePtr& page, bool shared) {
+				stats.Pages++;
+				if (shared || (page.use_count() > 1)) {
+					stats.Shared++;
+				} else {
+					stats.Private++;
+					stats.PrivateBytes += sizeof(Page) + CONTROL_BLOCK_BYTES;
+				}
+			};
+			if constexpr (Paging::Sparse) {
+				for (size_t i = 0; i < TABLE_COUNT; i++) {
+					const auto& table = (*_table)[i];
+					auto shared = table_shared || (table.use_count() > 1);
+					for (size_t j = 0; (j < TABLE_PAGES) && (i * TABLE_PAGES + j < PAGE_COUNT); j++) {
+						count_page((*table)[j], shared);
+					}
+					if (!shared) {
+						stats.PrivateBytes += sizeof(Table) + CONTROL_BLOCK_BYTES;
+					}
+				}
+			} else {
+				for (const auto& page : *_table) {
+					count_page(page, table_shared);
+				}
+			}
+			if (!table_shared) {
+				stats.PrivateBytes += sizeof(PageTable) + CONTROL_BLOCK_BYTES;
+			}
+			return stats;
+		}
+
 	private:
-		const string                         _name;
-		bitset<MS * Architecture::WORD_SIZE> _memory = { 0 };
+		const char*           _name; // static string
+		shared_ptr<PageTable> _table;
 		
 		template<size_t SZ>
 		auto get_bits(Reference<SZ> ref) const {
 			static_assert(SZ <= MS * WORD_SIZE);
-			auto result = BitUtils::get_bits<SZ, MS * WORD_SIZE>(_memory, ref.Address);
+			auto index  = ref.Address / WORD_SIZE;
+			auto offset = ref.Address % WORD_SIZE;
+			bitset<SZ> result = { 0 };
+			if (offset + SZ <= WORD_SIZE) {
+				result = bitset<SZ>(word(index) >> offset);
+			} else {
+				for (size_t i = 0; i < SZ; i++) {
+					result[i] = get_bit(ref.Address + i);
+				}
+			}
 			Utils::log_line(LogType::MemoryState, _name, ": R < ", ref, " = ", result);
 			return result;
 		}
+
+		NativeWord word(size_t index) const {
+			return (*get_page(index / PAGE_SIZE))[index % PAGE_SIZE];
+		}
+
+		const PagePtr& get_page(size_t page) const {
+			if constexpr (Paging::Sparse) {
+				return (*(*_table)[page / TABLE_PAGES])[page % TABLE_PAGES];
+			} else {
+				return (*_table)[page];
+			}
+		}
+
+		bool is_zero_page(size_t page) const {
+			if constexpr (Paging::Sparse) {
+				return get_page(page) == zero_page();
+			} else {
+				return false;
+			}
+		}
+
+		bool get_bit(size_t address) const {
+			return (word(address / WORD_SIZE) >> (address % WORD_SIZE)) & 1;
+		}
+
+		void set_bit(size_t address, bool value) {
+			auto& target = mutable_word(address / WORD_SIZE);
+			auto bit = static_cast<NativeWord>(1u << (address % WORD_SIZE));
+			target = static_cast<NativeWord>(value ? (target | bit) : (target & ~bit));
+		}
+
+		// Copies page table and page when they are seen by other states,
+		// the zero page is always seen by the zero table, so it is never written
+		NativeWord& mutable_word(size_t index) {
+			auto& page = private_slot(index / PAGE_SIZE);
+			if (!is_private(page)) {
+				page = std::make_shared<Page>(*page);
+			}
+			return (*page)[index % PAGE_SIZE];
+		}
+
+		// Page pointer in tables owned by this state only
+		PagePtr& private_slot(size_t page) {
+			if (!is_private(_table)) {
+				_table = std::make_shared<PageTable>(*_table);
+			}
+			if constexpr (Paging::Sparse) {
+				auto& table = (*_table)[page / TABLE_PAGES];
+				if (!is_private(table)) {
+					table = std::make_shared<Table>(*table);
+				}
+				return (*table)[page % TABLE_PAGES];
+			} else {
+				return (*_table)[page];
+			}
+		}
+
+		NativeWord& word(size_t index) {
+			return (*(*_table)[index / PAGE_SIZE])[index % PAGE_SIZE];
+		}
+
+		static const PagePtr& zero_page() {
+			static const auto page = std::make_shared<Page>();
+			return page;
+		}
+
+		// Page table of sparse state with no page written, shared by all such states
+		static const shared_ptr<PageTable>& zero_table() {
+			static const auto table = [] {
+				auto zero = std::make_shared<Table>();
+				zero->fill(zero_page());
+				auto result = std::make_shared<PageTable>();
+				result->fill(zero);
+				return result;
+			}();
+			return table;
+		}
+
+		// use_count() is a relaxed load, seeing count 1 alone does not order our writes after
+		// reads of the last other owner. It dropped the block with a release decrement,
+		// the acquire fence after reading its result provides that order.
+		template<class T>
+		static bool is_private(const shared_ptr<T>& ptr) {
+			if (ptr.use_count() > 1) {
+				return false;
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return true;
+		}
+
+		// Every page owned by this state only, shared pages are replaced without copying
+		void make_private() {
+			if (!_table || !is_private(_table)) {
+				_table = std::make_shared<PageTable>();
+			}
+			for (auto& page : *_table) {
+				if (!page || !is_private(page)) {
+					page = std::make_shared<Page>();
+				}
+			}
+		}
 	};
 	
-	using ControlBusState = MemoryState<1>;
-	using AddressBusState = MemoryState<1>;
-	using DataBusState    = MemoryState<1>;
+	const char* const BUS_NAMES[] = { "Control", "Address", "Data" };
+
+	// Bus latch: one word kept in place, with the same access as one word memory state.
+	// Buses are written every tick and are never worth sharing, so they are not paged.
+	template<size_t Bus>
+	class BusState {
+	public:
+		static constexpr size_t PAGED_SIZE = 1; // words of the bus in snapshots
+
+		void clear() {
+			_word = 0;
+		}
+
+		auto get_all() const {
+			return bitset<WORD_SIZE>(_word);
+		}
+
+		template<size_t SZ>
+		void set_bits(Reference<SZ> ref, const bitset<SZ>& value) {
+			static_assert(SZ <= WORD_SIZE);
+			auto mask = static_cast<NativeWord>(((uint64_t(1) << SZ) - 1) << ref.Address);
+			_word = static_cast<NativeWord>((_word & ~mask) | ((value.to_ulong() << ref.Address) & mask));
+			Utils::log_line(LogType::MemoryState, BUS_NAMES[Bus], ": W > ", ref, " = ", value);
+		}
+
+		template<size_t SZ>
+		void set_zero(Reference<SZ> ref) {
+			set_bits(ref, BitUtils::get_zero<SZ>());
+		}
+
+		template<size_t SZ>
+		auto operator[](Reference<SZ> ref) const {
+			static_assert(SZ <= WORD_SIZE);
+			auto result = bitset<SZ>(_word >> ref.Address);
+			Utils::log_line(LogType::MemoryState, BUS_NAMES[Bus], ": R < ", ref, " = ", result);
+			return result;
+		}
+
+		unsigned long peek(size_t) const {
+			return _word;
+		}
+
+		void poke(size_t, unsigned long value) {
+			_word = static_cast<NativeWord>(value);
+		}
+
+		PageStats get_page_stats() const {
+			return { };
+		}
+
+	private:
+		NativeWord _word = 0;
+	};
+
+	using ControlBusState = BusState<0>;
+	using AddressBusState = BusState<1>;
+	using DataBusState    = BusState<2>;
 }
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "CpuRunner.h"
+#include "RamRunner.h"
+#include "WordRunner.h"
+#include "MemoryState.h"
+#include "RegisterSet.h"
+#include "Architecture.h"
+
+using std::array;
+using std::atomic;
+using std::thread;
+using std::vector;
+
+using Logics::RamRunner;
+using Logics::CpuRunner;
+using State::MemoryState;
+using Architecture::WordSet;
+using Architecture::RegisterSet;
+
+namespace Core {
+	enum class Arbitration {
+		RoundRobin, // requesting core after the last granted one wins
+		Priority,   // requesting core with the lowest index wins
+	};
+
+	// Registers, pipeline and buses of one core, the buses connect it to the arbiter
+	template<size_t IMS>
+	class CoreState {
+	public:
+		MemoryState<IMS>       CPU        = { "CPU"     };
+		State::ControlBusState ControlBus;
+		State::AddressBusState AddressBus;
+		State::DataBusState    DataBus;
+	};
+
+	class CoreStats {
+	public:
+		uint64_t Grants  = 0; // RAM requests served
+		uint64_t Stalls  = 0; // ticks the core waited for the arbiter
+		uint64_t MaxWait = 0; // longest wait of one request, ticks
+	};
+
+	template<size_t Cores>
+	class ArbiterStats {
+	public:
+		uint64_t                 Ticks     = 0;
+		uint64_t                 Contended = 0; // ticks with more requests than ports
+		array<CoreStats, Cores>  PerCore   = { };
+	};
+
+	// Cores with own registers and buses sharing one RAM through an arbiter.
+	// RAM serves at most Ports requests per tick, a core whose request is not granted
+	// is stalled: neither its RAM request nor its pipeline advance in that tick.
+	// Granted requests are served in arbitration order, so with one port (or same
+	// policy and ports) the result does not depend on how cores are run.
+	// With one core it ticks exactly as Computer.
+	template<size_t IMS, size_t RMS, size_t Cores>
+	class MultiComputer {
+		static_assert(Cores > 0);
+		using Regs = RegisterSet<IMS>;
+
+	public:
+		static constexpr size_t CpuSize   = IMS;
+		static constexpr size_t RamSize   = RMS;
+		static constexpr size_t CoreCount = Cores;
+
+		Regs                        Registers;
+		array<CoreState<IMS>, Cores> State;
+		MemoryState<RMS>            RAM;
+
+		MultiComputer(WordSet<RMS> init_ram, Arbitration policy = Arbitration::RoundRobin, size_t ports = 1):
+			RAM("RAM", init_ram), _policy(policy), _ports(std::max<size_t>(ports, 1)) { }
+
+		const ArbiterStats<Cores>& get_stats() const {
+			return _stats;
+		}
+
+		bool is_running(size_t core) const {
+			return _running[core];
+		}
+
+		// False when all cores are terminated
+		bool tick(size_t ticks = 1) {
+			for (size_t i = 0; i < ticks; i++) {
+				arbitrate();
+				for (size_t core = 0; core < Cores; core++) {
+					tick_cpu(core);
+				}
+				if (!finish_tick()) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Ticks until all cores are terminated or tick limit (0 - no limit) is reached,
+		// pipelines of the cores are ticked by threads (each owns a group of cores),
+		// RAM requests are still served by the arbiter between pipeline steps,
+		// so the result is the same as of tick(). Returns ticks done.
+		uint64_t run(uint64_t max_ticks = 0, size_t threads = 1) {
+			threads = std::max<size_t>(1, std::min(threads, Cores));
+			uint64_t ticks = 0;
+			Barrier barrier(threads);
+			atomic<bool> done = { false };
+			auto tick_group = [&](size_t group) {
+				for (auto core = group; core < Cores; core += threads) {
+					tick_cpu(core);
+				}
+			};
+			vector<thread> workers;
+			for (size_t group = 1; group < threads; group++) {
+				workers.emplace_back([&, group]() {
+					for (;;) {
+						barrier.wait(); // arbitration is done
+						if (done.load(std::memory_order_relaxed)) {
+							return;
+						}
+						tick_group(group);
+						barrier.wait(); // pipelines are ticked
+					}
+				});
+			}
+			auto running = true;
+			while (running && ((max_ticks == 0) || (ticks < max_ticks))) {
+				arbitrate();
+				barrier.wait();
+				tick_group(0);
+				barrier.wait();
+				running = finish_tick();
+				ticks++;
+			}
+			done = true;
+			barrier.wait();
+			for (auto& worker : workers) {
+				worker.join();
+			}
+			return ticks;
+		}
+
+	private:
+		// Spinning barrier, the generation flips when the last thread arrives
+		class Barrier {
+		public:
+			Barrier(size_t count): _count(count) { }
+
+			void wait() {
+				auto generation = _generation.load(std::memory_order_acquire);
+				if (_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == _count) {
+					_arrived.store(0, std::memory_order_relaxed);
+					_generation.store(generation + 1, std::memory_order_release);
+					return;
+				}
+				while (_generation.load(std::memory_order_acquire) == generation) {
+					std::this_thread::yield();
+				}
+			}
+
+		private:
+			const size_t   _count;
+			atomic<size_t> _arrived    = { 0 };
+			atomic<size_t> _generation = { 0 };
+		};
+
+		const Arbitration     _policy;
+		const size_t          _ports;
+		ArbiterStats<Cores>   _stats;
+		array<bool, Cores>    _running  = make_filled(true);
+		array<bool, Cores>    _stalled  = { };
+		array<bool, Cores>    _ticked   = { }; // result of the pipeline tick
+		array<uint64_t, Cores> _waiting = { };
+		size_t                _next     = 0; // round-robin start
+
+		static array<bool, Cores> make_filled(bool value) {
+			array<bool, Cores> result;
+			result.fill(value);
+			return result;
+		}
+
+		bool has_request(size_t core) const {
+			return _running[core] && ((State[core].ControlBus.peek(0) & Logics::WordLayout::BUS_ENABLED) != 0);
+		}
+
+		// Serves granted RAM requests in arbitration order, marks other requesting cores stalled
+		void arbitrate() {
+			size_t requests = 0;
+			size_t granted = 0;
+			auto first = (_policy == Arbitration::RoundRobin) ? _next : 0;
+			for (size_t i = 0; i < Cores; i++) {
+				auto core = (first + i) % Cores;
+				_stalled[core] = false;
+				if (!has_request(core)) {
+					continue;
+				}
+				requests++;
+				auto& stats = _stats.PerCore[core];
+				if (granted < _ports) {
+					granted++;
+					stats.Grants++;
+					_waiting[core] = 0;
+					_next = (core + 1) % Cores;
+					auto& state = State[core];
+					RamRunner<RMS>(state.ControlBus, state.AddressBus, state.DataBus, RAM).tick();
+				} else {
+					_stalled[core] = true;
+					stats.Stalls++;
+					_waiting[core]++;
+					stats.MaxWait = std::max(stats.MaxWait, _waiting[core]);
+				}
+			}
+			_stats.Contended += (requests > _ports) ? 1 : 0;
+		}
+
+		void tick_cpu(size_t core) {
+			if (!_running[core] || _stalled[core]) {
+				_ticked[core] = _running[core];
+				return;
+			}
+			auto& state = State[core];
+			_ticked[core] = CpuRunner<IMS, RMS>(Registers, state.CPU, state.ControlBus, state.AddressBus, state.DataBus).tick();
+		}
+
+		bool finish_tick() {
+			_stats.Ticks++;
+			auto any = false;
+			for (size_t core = 0; core < Cores; core++) {
+				_running[core] = _ticked[core];
+				any = any || _running[core];
+			}
+			return any;
+		}
+	};
+}
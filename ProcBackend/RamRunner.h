@@ -6,6 +6,7 @@
 #include "Reference.h"
 #include "MemoryState.h"
 #include "Architecture.h"
+#include "Instrumentation.h"
 
 using std::bitset;
 
@@ -16,16 +17,19 @@ using State::MemoryState;
 using Architecture::Word;
 
 namespace Logics {
-	template<size_t RMS>
+	template<size_t RMS, class ProbePolicy = Instrumentation::NoProbe, class Paging = State::DensePaging>
 	class RamRunner {
 		using ControlBus = const State::ControlBusState&;
 		using AddrBus    = const State::AddressBusState&;
 		using DataBus    = State::DataBusState&;
-		using Ram        = MemoryState<RMS>&;
+		using Ram        = MemoryState<RMS, Paging>&;
 	public:
 		RamRunner(ControlBus control_bus, AddrBus address_bus, DataBus data_bus, Ram ram):
 			_control_bus(control_bus), _address_bus(address_bus), _data_bus(data_bus), _ram(ram) { }
 
+		RamRunner(ControlBus control_bus, AddrBus address_bus, DataBus data_bus, Ram ram, ProbePolicy& probe):
+			_control_bus(control_bus), _address_bus(address_bus), _data_bus(data_bus), _ram(ram), _probe(&probe) { }
+
 		bool tick() {
 			// 0000 - [ 1 - enabled, 0 - disabled ]
 			// 0001 - [ 0 - read,    1 - write    ]
@@ -52,10 +56,11 @@ namespace Logics {
 		}
 
 	private:
-		ControlBus  _control_bus;
-		AddrBus     _address_bus;
-		DataBus     _data_bus;
-		Ram         _ram;
+		ControlBus   _control_bus;
+		AddrBus      _address_bus;
+		DataBus      _data_bus;
+		Ram          _ram;
+		ProbePolicy* _probe = nullptr;
 
 		bool is_enabled() {
 			return _control_bus[FReference(0)].test(0);
@@ -64,16 +69,34 @@ namespace Logics {
 		bool is_write() {
 			return _control_bus[FReference(1)].test(0);
 		}
+
+		bool is_in_range(const Word& address) {
+			return address.to_ulong() < RMS;
+		}
 		
 		void process_read(const Word& address) {
 			Utils::log_line(LogType::RamRunner, "RamRunner.process_read(", address, ")");
+			if (!is_in_range(address)) {
+				// Addresses out of RAM read as zero
+				_data_bus.set_zero(WReference(0));
+				return;
+			}
 			auto value = _ram[WReference(address.to_ulong() * Architecture::WORD_SIZE)];
 			_data_bus.set_bits(WReference(0), value);
+			if constexpr (ProbePolicy::Enabled) {
+				_probe->on_ram_read(address.to_ulong());
+			}
 		}
 
 		void process_write(const Word& address, const Word& data) {
 			Utils::log_line(LogType::RamRunner, "RamRunner.process_write(", address, ", ", data, ")");
+			if (!is_in_range(address)) {
+				return; // writes out of RAM are ignored
+			}
 			_ram.set_bits(WReference(address.to_ulong() * Architecture::WORD_SIZE), data);
+			if constexpr (ProbePolicy::Enabled) {
+				_probe->on_ram_write(address.to_ulong());
+			}
 		}
 	};
 }
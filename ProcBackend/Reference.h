@@ -9,14 +9,16 @@ using std::string;
 using std::ostream;
 
 namespace Core {
+	// Bits of a memory state, names point to static tables (literals), so references are constants
 	template<size_t SZ>
 	class Reference {
 	public:
+		static constexpr size_t Size = SZ;
+
 		const size_t Address;
-		const size_t Size = SZ;
-		const string FriendlyName;
+		const char*  FriendlyName;
 
-		Reference(size_t address = 0, const string& name = ""): Address(address), FriendlyName(name) {}
+		constexpr Reference(size_t address = 0, const char* name = ""): Address(address), FriendlyName(name) {}
 	};
 	
 	using FReference  = Reference<1>; // Flag reference
@@ -27,7 +29,7 @@ namespace Core {
 	template<size_t SZ>
 	ostream& operator <<(ostream& os, const Reference<SZ>& ref) {
 		os << ref.Address << ":" << SZ;
-		if ( !ref.FriendlyName.empty() ) {
+		if ( *ref.FriendlyName != '\0' ) {
 			os << " (" << ref.FriendlyName << ")";
 		}
 		return os;
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <array>
 #include <bitset>
+#include <string>
+#include <stdexcept>
 
 #include "Reference.h"
 #include "Architecture.h"
 
+using std::array;
 using std::bitset;
+using std::string;
 
 using Core::Reference;
 using Core::WReference;
@@ -15,6 +20,12 @@ using Architecture::Word;
 using Architecture::WORD_SIZE;
 
 namespace Architecture {
+	// Bit address of CPU memory word
+	constexpr size_t get_word_address(size_t index) {
+		return index * WORD_SIZE;
+	}
+
+	// Register layout is a compile-time constant, register sets hold no data
 	template<size_t IMS>
 	class RegisterSet {
 	public:
@@ -26,42 +37,42 @@ namespace Architecture {
 		//         1
 		//         2
 		//         3 Argument mode (is 2th argument required)
-		WReference  System        = { get_address_at(0)    , "SS" };
-		PSReference PipelineState = { get_address_at(0) + 0, "PS" };
-		FReference  ArgumentMode  = { get_address_at(0) + 3, "AM" };
+		static constexpr WReference  System        = { get_word_address(0)    , "SS" };
+		static constexpr PSReference PipelineState = { get_word_address(0) + 0, "PS" };
+		static constexpr FReference  ArgumentMode  = { get_word_address(0) + 3, "AM" };
 
 		// Command Code
-		WReference CommandCode = { get_address_at(1), "CC" };
+		static constexpr WReference CommandCode = { get_word_address(1), "CC" };
 
 		// Argument #1
-		WReference Arg1 = { get_address_at(2), "A1" };
+		static constexpr WReference Arg1 = { get_word_address(2), "A1" };
 
 		// Argument #2
-		WReference Arg2 = { get_address_at(3), "A2" };
+		static constexpr WReference Arg2 = { get_word_address(3), "A2" };
 
 		// Flags 0 Terminated       (execution completed)
 		//       1 Integer Overflow (last operation raised overflow)
 		//       2 Fatal Error      (IP or Counter is out of range)
 		//       3 Zero Flag        (is last CMP operation succeded)
-		WReference Flags      = { get_address_at(4)    , "FS" };
-		FReference Terminated = { get_address_at(4) + 0, "TR" };
-		FReference Overflow   = { get_address_at(4) + 1, "OF" };
-		FReference Fatal      = { get_address_at(4) + 2, "FT" };
-		FReference Zero       = { get_address_at(4) + 3, "ZF" };
+		static constexpr WReference Flags      = { get_word_address(4)    , "FS" };
+		static constexpr FReference Terminated = { get_word_address(4) + 0, "TR" };
+		static constexpr FReference Overflow   = { get_word_address(4) + 1, "OF" };
+		static constexpr FReference Fatal      = { get_word_address(4) + 2, "FT" };
+		static constexpr FReference Zero       = { get_word_address(4) + 3, "ZF" };
 
 		// Counter (how many commands was processed)
-		WReference Counter = { get_address_at(5), "CR" };
+		static constexpr WReference Counter = { get_word_address(5), "CR" };
 
 		// IP (next instruction ram pointer)
-		WReference IP = { get_address_at(6), "IP" };
+		static constexpr WReference IP = { get_word_address(6), "IP" };
 
 		// AR (accumulator register)
-		WReference AR = { get_address_at(7), "AR" };
+		static constexpr WReference AR = { get_word_address(7), "AR" };
 
 		// CR1 (Common register #1)
 		// ...
 		// CRN (Common register #N)
-		auto get_CN(const Word& index) const {
+		static WReference get_CN(const Word& index) {
 			auto index_val = index.to_ulong();
 			if ( index_val >= get_CN_count() ) {
 				throw new std::runtime_error("Invalid C register index");
@@ -69,20 +80,33 @@ namespace Architecture {
 			return get_CN(index_val);
 		}
 		
-		auto get_CN(size_t index) const {
-			return get_register(SERVICE_REGISTERS + index, "CR" + std::to_string(index));
+		static WReference get_CN(size_t index) {
+			return get_register(SERVICE_REGISTERS + index, get_CN_name(index));
 		}
 
-		constexpr size_t get_CN_count() const {
+		static constexpr size_t get_CN_count() {
 			return IMS - SERVICE_REGISTERS;
 		}
 
-		constexpr size_t get_address_at(size_t index) const {
-			return index * WORD_SIZE;
+		static constexpr size_t get_address_at(size_t index) {
+			return get_word_address(index);
+		}
+
+		static constexpr WReference get_register(size_t index, const char* name = "") {
+			return WReference(get_word_address(index), name);
 		}
 
-		auto get_register(size_t index, const string& name = "") const {
-			return WReference(get_address_at(index), name);
+	private:
+		// "CR0", "CR1" ... made once per CPU memory size
+		static const char* get_CN_name(size_t index) {
+			static const auto names = [] {
+				array<string, IMS - SERVICE_REGISTERS> result;
+				for (size_t i = 0; i < result.size(); i++) {
+					result[i] = "CR" + std::to_string(i);
+				}
+				return result;
+			}();
+			return (index < names.size()) ? names[index].c_str() : "";
 		}
 	};
 }
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Hash.h"
+#include "Fleet.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "Architecture.h"
+
+using std::list;
+using std::mutex;
+using std::string;
+using std::vector;
+using std::lock_guard;
+using std::unordered_map;
+
+using Utils::MappedFile;
+using Architecture::Word;
+using Architecture::WordSet;
+using Architecture::WORD_SIZE;
+using Architecture::WORD_BYTES;
+
+namespace Fleet {
+	// Cached result file layout, numbers are little-endian:
+	//  0 char[4] magic "CPRC"
+	//  4 uint16  format version
+	//  6 uint16  word size in bits
+	//  8 uint32  RAM size in words
+	// 12 uint32  CPU memory size in words
+	// 16 uint64  key
+	// 24 uint64  tick budget of the job
+	// 32 uint32  entry IP of the job
+	// 36 uint32  status
+	// 40 uint64  ticks
+	// 48 uint64  checksum of header bytes 0..47 and payload (FNV-1a)
+	// 56 payload: job registers, job RAM, result CPU memory, result RAM, WORD_BYTES bytes per word
+	namespace CacheFile {
+		const char     MAGIC[4]    = { 'C', 'P', 'R', 'C' };
+		const uint16_t VERSION     = 2;
+		const size_t   HEADER_SIZE = 56;
+		const char*    EXTENSION   = ".result";
+	}
+
+	// Memoisation of job runs: emulation is deterministic, so a job with the same program,
+	// memory sizes and tick budget always gives the same result. Results are kept in
+	// an in-memory LRU and optionally in a directory with a size limit (oldest files are removed).
+	// Jobs stopped by deadline are not cached, the timeout is not a part of the key.
+	// Entries keep their job input, so a hash collision is a miss, not a wrong result.
+	// Safe to use from several threads, e.g. as Executor runner.
+	// Files are read and written without holding the lock, it guards only the LRU and metrics.
+	template<size_t IMS, size_t RMS>
+	class ResultCache {
+		using JobType    = Job<IMS, RMS>;
+		using ResultType = Result<IMS, RMS>;
+
+		class Entry {
+		public:
+			uint64_t   Key = 0;
+			JobType    Input;
+			ResultType Output;
+		};
+
+	public:
+		class Metrics {
+		public:
+			uint64_t Hits          = 0; // found in memory
+			uint64_t DiskHits      = 0; // found on disk
+			uint64_t Misses        = 0;
+			uint64_t Evictions     = 0; // removed from memory
+			uint64_t DiskEvictions = 0; // files removed by size limit
+			uint64_t DiskBytes     = 0; // size of cached files
+		};
+
+		// capacity: entries in memory, directory: empty - no disk store, max_disk_bytes: 0 - no limit
+		ResultCache(size_t capacity, const string& directory = "", uint64_t max_disk_bytes = 0):
+			_capacity(std::max<size_t>(capacity, 1)), _directory(directory), _max_disk_bytes(max_disk_bytes) {
+			if (!_directory.empty()) {
+				std::error_code error;
+				std::filesystem::create_directories(_directory, error);
+				for (const auto& file : list_files()) {
+					_metrics.DiskBytes += file.Size;
+				}
+			}
+		}
+
+		static uint64_t get_key(const JobType& job) {
+			auto hash = Utils::hash_value(CacheFile::VERSION);
+			hash = Utils::hash_value(WORD_SIZE, hash);
+			hash = Utils::hash_value(IMS, hash);
+			hash = Utils::hash_value(RMS, hash);
+			hash = Utils::hash_value(job.MaxTicks, hash);
+			hash = Utils::hash_value(job.Program.EntryIP, hash);
+			for (const auto& word : job.Program.Registers) {
+				hash = Utils::hash_value(word.to_ullong(), hash);
+			}
+			for (const auto& word : job.Program.Ram) {
+				hash = Utils::hash_value(word.to_ullong(), hash);
+			}
+			return hash;
+		}
+
+		bool find(const JobType& job, ResultType& result) {
+			auto key = get_key(job);
+			{
+				lock_guard<mutex> lock(_mutex);
+				auto it = _index.find(key);
+				if ((it != _index.end()) && is_same_input(it->second->Input, job)) {
+					_entries.splice(_entries.begin(), _entries, it->second);
+					_metrics.Hits++;
+					result = it->second->Output;
+					result.Id = job.Id;
+					return true;
+				}
+				if (_directory.empty()) {
+					_metrics.Misses++;
+					return false;
+				}
+			}
+			Entry entry;
+			auto found = load(key, entry) && is_same_input(entry.Input, job);
+			if (found) {
+				std::error_code error;
+				std::filesystem::last_write_time(get_path(key), std::filesystem::file_time_type::clock::now(), error);
+				result = entry.Output;
+				result.Id = job.Id;
+			}
+			lock_guard<mutex> lock(_mutex);
+			if (!found) {
+				_metrics.Misses++;
+				return false;
+			}
+			_metrics.DiskHits++;
+			insert(std::move(entry));
+			return true;
+		}
+
+		void store(const JobType& job, const ResultType& result) {
+			if (result.Status == JobStatus::Deadline) {
+				return;
+			}
+			Entry entry;
+			entry.Key    = get_key(job);
+			entry.Input  = job;
+			entry.Output = result;
+			uint64_t old_size = 0, new_size = 0;
+			auto saved = !_directory.empty() && save(entry, old_size, new_size);
+			auto trim = false;
+			{
+				lock_guard<mutex> lock(_mutex);
+				if (saved) {
+					_metrics.DiskBytes += new_size - std::min<uint64_t>(old_size, _metrics.DiskBytes);
+					trim = (_max_disk_bytes > 0) && (_metrics.DiskBytes > _max_disk_bytes);
+				}
+				insert(std::move(entry));
+			}
+			if (trim) {
+				trim_disk();
+			}
+		}
+
+		// Cached result, or result of run_job which is cached then
+		ResultType operator()(Computer<IMS, RMS>& cmp, const JobType& job) {
+			ResultType result;
+			if (find(job, result)) {
+				return result;
+			}
+			result = run_job(cmp, job);
+			store(job, result);
+			return result;
+		}
+
+		Metrics get_metrics() const {
+			lock_guard<mutex> lock(_mutex);
+			return _metrics;
+		}
+
+		size_t size() const {
+			lock_guard<mutex> lock(_mutex);
+			return _entries.size();
+		}
+
+	private:
+		class FileInfo {
+		public:
+			std::filesystem::path            Path;
+			uint64_t                         Size;
+			std::filesystem::file_time_type  Time;
+		};
+
+		const size_t      _capacity;
+		const string      _directory;
+		const uint64_t    _max_disk_bytes;
+		mutable mutex     _mutex;
+		mutex             _trim_mutex; // one thread trims the directory at a time
+		list<Entry>       _entries; // most recently used first
+		unordered_map<uint64_t, typename list<Entry>::iterator> _index;
+		Metrics           _metrics;
+
+		static bool is_same_input(const JobType& a, const JobType& b) {
+			return (a.MaxTicks == b.MaxTicks) && (a.Program.EntryIP == b.Program.EntryIP) &&
+				(a.Program.Registers == b.Program.Registers) && (a.Program.Ram == b.Program.Ram);
+		}
+
+		void insert(Entry&& entry) {
+			auto it = _index.find(entry.Key);
+			if (it != _index.end()) {
+				_entries.erase(it->second);
+				_index.erase(it);
+			}
+			_entries.push_front(std::move(entry));
+			_index[_entries.front().Key] = _entries.begin();
+			while (_entries.size() > _capacity) {
+				_index.erase(_entries.back().Key);
+				_entries.pop_back();
+				_metrics.Evictions++;
+			}
+		}
+
+		string get_path(uint64_t key) const {
+			std::ostringstream name;
+			name << std::hex;
+			name.width(16);
+			name.fill('0');
+			name << key;
+			return (std::filesystem::path(_directory) / (name.str() + CacheFile::EXTENSION)).string();
+		}
+
+		vector<FileInfo> list_files() const {
+			vector<FileInfo> files;
+			std::error_code error;
+			for (const auto& item : std::filesystem::directory_iterator(_directory, error)) {
+				if (item.is_regular_file(error) && (item.path().extension() == CacheFile::EXTENSION)) {
+					files.push_back({ item.path(), uint64_t(item.file_size(error)), item.last_write_time(error) });
+				}
+			}
+			return files;
+		}
+
+		template<size_t N>
+		static void write_words(std::ostream& os, const WordSet<N>& words) {
+			for (const auto& word : words) {
+				Images::write_le(os, word.to_ullong(), WORD_BYTES);
+			}
+		}
+
+		template<size_t N>
+		static void read_words(const uint8_t*& data, WordSet<N>& words) {
+			for (auto& word : words) {
+				word = Word(Images::read_le<uint64_t>(data, WORD_BYTES));
+				data += WORD_BYTES;
+			}
+		}
+
+		// Writes entry file, sizes of the replaced and the new file are returned for accounting
+		bool save(const Entry& entry, uint64_t& old_size, uint64_t& new_size) const {
+			std::ostringstream payload;
+			write_words(payload, entry.Input.Program.Registers);
+			write_words(payload, entry.Input.Program.Ram);
+			write_words(payload, entry.Output.Cpu);
+			write_words(payload, entry.Output.Ram);
+			auto bytes = payload.str();
+
+			auto path = get_path(entry.Key);
+			std::error_code error;
+			old_size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+			std::ostringstream header;
+			header.write(CacheFile::MAGIC, sizeof(CacheFile::MAGIC));
+			Images::write_le<uint16_t>(header, CacheFile::VERSION);
+			Images::write_le<uint16_t>(header, WORD_SIZE);
+			Images::write_le<uint32_t>(header, RMS);
+			Images::write_le<uint32_t>(header, IMS);
+			Images::write_le<uint64_t>(header, entry.Key);
+			Images::write_le<uint64_t>(header, entry.Input.MaxTicks);
+			Images::write_le<uint32_t>(header, entry.Input.Program.EntryIP);
+			Images::write_le<uint32_t>(header, uint32_t(entry.Output.Status));
+			Images::write_le<uint64_t>(header, entry.Output.Ticks);
+			auto prefix = header.str();
+			auto checksum = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(prefix.data()), prefix.size());
+			checksum = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), checksum);
+			Images::write_le<uint64_t>(header, checksum);
+			{
+				auto f = std::ofstream(path, std::ios::binary | std::ios::out | std::ios::trunc);
+				f << header.str();
+				f.write(bytes.data(), bytes.size());
+				if (f.fail()) {
+					return false; // disk store is best effort
+				}
+			}
+			new_size = CacheFile::HEADER_SIZE + bytes.size();
+			return true;
+		}
+
+		// Removes least recently used files until the store fits into the limit,
+		// skipped when another thread is already trimming
+		void trim_disk() {
+			std::unique_lock<mutex> trim_lock(_trim_mutex, std::try_to_lock);
+			if (!trim_lock) {
+				return;
+			}
+			auto files = list_files();
+			std::sort(files.begin(), files.end(), [](const FileInfo& a, const FileInfo& b) { return a.Time < b.Time; });
+			uint64_t total = 0;
+			for (const auto& file : files) {
+				total += file.Size;
+			}
+			uint64_t evicted = 0;
+			for (const auto& file : files) {
+				if (total <= _max_disk_bytes) {
+					break;
+				}
+				std::error_code error;
+				if (std::filesystem::remove(file.Path, error)) {
+					total -= file.Size;
+					evicted++;
+				}
+			}
+			lock_guard<mutex> lock(_mutex);
+			_metrics.DiskEvictions += evicted;
+			_metrics.DiskBytes = total;
+		}
+
+		bool load(uint64_t key, Entry& entry) const {
+			auto file = MappedFile(get_path(key));
+			const auto payload_size = (2 * (IMS + RMS)) * WORD_BYTES;
+			if (!file.is_open() || (file.size() != CacheFile::HEADER_SIZE + payload_size)) {
+				return false;
+			}
+			auto data = file.data();
+			if ((std::memcmp(data, CacheFile::MAGIC, sizeof(CacheFile::MAGIC)) != 0) ||
+				(Images::read_le<uint16_t>(data + 4) != CacheFile::VERSION) ||
+				(Images::read_le<uint16_t>(data + 6) != WORD_SIZE) ||
+				(Images::read_le<uint32_t>(data + 8) != RMS) ||
+				(Images::read_le<uint32_t>(data + 12) != IMS) ||
+				(Images::read_le<uint64_t>(data + 16) != key)) {
+				return false;
+			}
+			auto payload = data + CacheFile::HEADER_SIZE;
+			auto checksum = Utils::hash_bytes(data, 48);
+			checksum = Utils::hash_bytes(payload, payload_size, checksum);
+			if (checksum != Images::read_le<uint64_t>(data + 48)) {
+				return false;
+			}
+			auto status = Images::read_le<uint32_t>(data + 36);
+			if (status > uint32_t(JobStatus::Invalid)) {
+				return false;
+			}
+			entry.Key                   = key;
+			entry.Input.MaxTicks        = Images::read_le<uint64_t>(data + 24);
+			entry.Input.Program.EntryIP = Images::read_le<uint32_t>(data + 32);
+			entry.Output.Status         = JobStatus(status);
+			entry.Output.Ticks          = Images::read_le<uint64_t>(data + 40);
+			read_words(payload, entry.Input.Program.Registers);
+			read_words(payload, entry.Input.Program.Ram);
+			read_words(payload, entry.Output.Cpu);
+			read_words(payload, entry.Output.Ram);
+			return true;
+		}
+	};
+}
@@ -0,0 +1,525 @@
+#pragma once
+
+#include <tuple>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+#include "Hash.h"
+#include "Fleet.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "Architecture.h"
+
+using std::tuple;
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+using Images::Image;
+using Utils::MappedFile;
+using Architecture::Word;
+using Architecture::WordSet;
+using Architecture::WORD_SIZE;
+using Architecture::WORD_BYTES;
+using Architecture::SERVICE_REGISTERS;
+
+namespace Shards {
+	// Job of a manifest line: <image path> [ticks=<n>] [ip=<n>] [r<i>=<value>]...
+	// Path is relative to manifest directory and has no spaces, numbers may be hex (0x..).
+	// Empty lines and lines starting with '#' are skipped.
+	class Entry {
+	public:
+		class Override {
+		public:
+			size_t Index; // CPU word index, r<i> is SERVICE_REGISTERS + i
+			size_t Value;
+		};
+
+		string           Path;         // as written in manifest
+		string           ResolvedPath;
+		size_t           MaxTicks = 0; // 0 - default of the run
+		size_t           EntryIP  = 0; // 0 - entry IP of the image
+		vector<Override> Registers;
+	};
+
+	class Manifest {
+	public:
+		vector<Entry> Jobs;
+		uint64_t      Hash = Utils::FNV_OFFSET; // of the jobs as written, same on every node
+	};
+
+	bool parse_number(const string& str, size_t& value) {
+		try {
+			size_t end = 0;
+			value = std::stoull(str, &end, 0);
+			return end == str.size();
+		} catch (std::exception&) {
+			return false;
+		}
+	}
+
+	tuple<bool, string> parse_entry(const string& line, Entry& entry) {
+		std::istringstream is(line);
+		is >> entry.Path;
+		string field;
+		while (is >> field) {
+			auto equal = field.find('=');
+			if (equal == string::npos) {
+				return { false, "expected key=value: " + field };
+			}
+			auto key = field.substr(0, equal);
+			size_t value = 0;
+			if (!parse_number(field.substr(equal + 1), value)) {
+				return { false, "bad number: " + field };
+			}
+			size_t index = 0;
+			if (key == "ticks") {
+				entry.MaxTicks = value;
+			} else if (key == "ip") {
+				entry.EntryIP = value;
+			} else if ((key.size() > 1) && (key[0] == 'r') && parse_number(key.substr(1), index)) {
+				entry.Registers.push_back({ SERVICE_REGISTERS + index, value });
+			} else {
+				return { false, "unknown key: " + key };
+			}
+		}
+		return { true, "" };
+	}
+
+	tuple<bool, string> load_manifest(const string& path, Manifest& manifest) {
+		namespace fs = std::filesystem;
+		auto f = std::ifstream(path);
+		if (!f.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		manifest = Manifest();
+		auto base = fs::path(path).parent_path();
+		string line;
+		for (size_t number = 1; std::getline(f, line); number++) {
+			if (!line.empty() && (line.back() == '\r')) {
+				line.pop_back();
+			}
+			if (line.empty() || (line[0] == '#')) {
+				continue;
+			}
+			Entry entry;
+			auto [ok, error] = parse_entry(line, entry);
+			if (!ok) {
+				return { false, path + ":" + std::to_string(number) + ": " + error };
+			}
+			auto image_path = fs::path(entry.Path);
+			entry.ResolvedPath = (image_path.is_absolute() ? image_path : base / image_path).string();
+			manifest.Hash = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(line.data()), line.size(), manifest.Hash);
+			manifest.Hash = Utils::hash_value(manifest.Jobs.size(), manifest.Hash);
+			manifest.Jobs.push_back(entry);
+		}
+		return { true, "" };
+	}
+
+	// Shard Index of Count owns jobs with index % Count == Index
+	class Shard {
+	public:
+		size_t Index = 0;
+		size_t Count = 1;
+
+		bool owns(size_t job) const {
+			return job % Count == Index;
+		}
+	};
+
+	// Parses "k/n"
+	bool parse_shard(const string& str, Shard& shard) {
+		auto slash = str.find('/');
+		return (slash != string::npos) && parse_number(str.substr(0, slash), shard.Index) &&
+			parse_number(str.substr(slash + 1), shard.Count) && (shard.Index < shard.Count);
+	}
+
+	// Shard and merged result files share the header, numbers are little-endian:
+	//  0 char[4] magic "CPSR" (shard) or "CPMR" (merged)
+	//  4 uint16  format version
+	//  6 uint16  word size in bits
+	//  8 uint32  RAM size in words
+	// 12 uint32  CPU memory size in words
+	// 16 uint32  shard index (0 in merged file)
+	// 20 uint32  shard count
+	// 24 uint64  jobs in manifest
+	// 32 uint64  run key: manifest hash and default tick budget
+	// 40 uint64  reserved (0)
+	// Shard file: records appended as jobs complete, in any order.
+	// Merged file: uint64 offset of the record of every job (0 - missing), then records by job index.
+	// Record: uint64 job index, uint32 status, uint32 reserved, uint64 ticks,
+	//         CPU memory words, RAM words (WORD_BYTES bytes per word), uint64 checksum of the record (FNV-1a)
+	const char     SHARD_MAGIC[4]  = { 'C', 'P', 'S', 'R' };
+	const char     MERGED_MAGIC[4] = { 'C', 'P', 'M', 'R' };
+	const uint16_t VERSION         = 1;
+	const size_t   HEADER_SIZE     = 48;
+
+	class Header {
+	public:
+		uint32_t RamSize    = 0;
+		uint32_t CpuSize    = 0;
+		uint32_t ShardIndex = 0;
+		uint32_t ShardCount = 1;
+		uint64_t JobCount   = 0;
+		uint64_t RunKey     = 0;
+
+		// Shard files of one run differ only by shard index
+		bool same_run(const Header& other) const {
+			return (RamSize == other.RamSize) && (CpuSize == other.CpuSize) && (ShardCount == other.ShardCount) &&
+				(JobCount == other.JobCount) && (RunKey == other.RunKey);
+		}
+	};
+
+	void write_header(std::ostream& os, const char* magic, const Header& header) {
+		os.write(magic, 4);
+		Images::write_le<uint16_t>(os, VERSION);
+		Images::write_le<uint16_t>(os, WORD_SIZE);
+		Images::write_le<uint32_t>(os, header.RamSize);
+		Images::write_le<uint32_t>(os, header.CpuSize);
+		Images::write_le<uint32_t>(os, header.ShardIndex);
+		Images::write_le<uint32_t>(os, header.ShardCount);
+		Images::write_le<uint64_t>(os, header.JobCount);
+		Images::write_le<uint64_t>(os, header.RunKey);
+		Images::write_le<uint64_t>(os, 0);
+	}
+
+	tuple<bool, string> read_header(const uint8_t* data, size_t size, const char* magic, Header& header) {
+		if ((size < HEADER_SIZE) || (std::memcmp(data, magic, 4) != 0)) {
+			return { false, "not a " + string(magic, 4) + " results file" };
+		}
+		auto version   = Images::read_le<uint16_t>(data + 4);
+		auto word_size = Images::read_le<uint16_t>(data + 6);
+		if (version != VERSION) {
+			return { false, "unsupported version " + std::to_string(version) };
+		}
+		if (word_size != WORD_SIZE) {
+			return { false, "word size " + std::to_string(word_size) + " != " + std::to_string(WORD_SIZE) };
+		}
+		header.RamSize    = Images::read_le<uint32_t>(data + 8);
+		header.CpuSize    = Images::read_le<uint32_t>(data + 12);
+		header.ShardIndex = Images::read_le<uint32_t>(data + 16);
+		header.ShardCount = Images::read_le<uint32_t>(data + 20);
+		header.JobCount   = Images::read_le<uint64_t>(data + 24);
+		header.RunKey     = Images::read_le<uint64_t>(data + 32);
+		if ((header.ShardCount == 0) || (header.ShardIndex >= header.ShardCount)) {
+			return { false, "bad shard " + std::to_string(header.ShardIndex) + "/" + std::to_string(header.ShardCount) };
+		}
+		return { true, "" };
+	}
+
+	size_t get_record_size(size_t cpu_size, size_t ram_size) {
+		return 24 + (cpu_size + ram_size) * WORD_BYTES + 8;
+	}
+
+	// Record at data is complete and not corrupted
+	bool is_valid_record(const uint8_t* data, size_t record_size) {
+		auto checksum = Images::read_le<uint64_t>(data + record_size - 8);
+		return Utils::hash_bytes(data, record_size - 8) == checksum;
+	}
+
+	template<size_t IMS, size_t RMS>
+	void write_record(std::ostream& os, size_t index, const Fleet::Result<IMS, RMS>& result) {
+		std::ostringstream record;
+		Images::write_le<uint64_t>(record, index);
+		Images::write_le<uint32_t>(record, uint32_t(result.Status));
+		Images::write_le<uint32_t>(record, 0);
+		Images::write_le<uint64_t>(record, result.Ticks);
+		for (const auto& word : result.Cpu) {
+			Images::write_le(record, word.to_ullong(), WORD_BYTES);
+		}
+		for (const auto& word : result.Ram) {
+			Images::write_le(record, word.to_ullong(), WORD_BYTES);
+		}
+		auto bytes = record.str();
+		os.write(bytes.data(), bytes.size());
+		Images::write_le<uint64_t>(os, Utils::hash_bytes(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()));
+	}
+
+	template<size_t IMS, size_t RMS>
+	void read_record(const uint8_t* data, Fleet::Result<IMS, RMS>& result) {
+		result.Id     = size_t(Images::read_le<uint64_t>(data));
+		result.Status = Fleet::JobStatus(Images::read_le<uint32_t>(data + 8));
+		result.Ticks  = size_t(Images::read_le<uint64_t>(data + 16));
+		auto words = data + 24;
+		for (auto& word : result.Cpu) {
+			word = Word(Images::read_le<uint64_t>(words, WORD_BYTES));
+			words += WORD_BYTES;
+		}
+		for (auto& word : result.Ram) {
+			word = Word(Images::read_le<uint64_t>(words, WORD_BYTES));
+			words += WORD_BYTES;
+		}
+	}
+
+	// Run key: results of runs with another manifest or default tick budget do not mix
+	uint64_t get_run_key(const Manifest& manifest, size_t default_max_ticks) {
+		return Utils::hash_value(default_max_ticks, manifest.Hash);
+	}
+
+	template<size_t IMS, size_t RMS>
+	tuple<bool, string> make_job(const Entry& entry, size_t index, size_t default_max_ticks, Fleet::Job<IMS, RMS>& job) {
+		job = Fleet::Job<IMS, RMS>();
+		auto [ok, error] = Images::load(entry.ResolvedPath, job.Program);
+		if (!ok) {
+			return { false, entry.ResolvedPath + ": " + error };
+		}
+		for (const auto& reg : entry.Registers) {
+			if (reg.Index >= IMS) {
+				return { false, entry.Path + ": no register " + std::to_string(reg.Index - SERVICE_REGISTERS) };
+			}
+			job.Program.Registers[reg.Index] = Word(reg.Value);
+		}
+		if (entry.EntryIP >= RMS) {
+			return { false, entry.Path + ": entry IP " + std::to_string(entry.EntryIP) + " is out of RAM" };
+		}
+		if (entry.EntryIP != 0) {
+			job.Program.EntryIP = entry.EntryIP;
+		}
+		job.Id       = index;
+		job.MaxTicks = (entry.MaxTicks != 0) ? entry.MaxTicks : default_max_ticks;
+		return { true, "" };
+	}
+
+	class ShardReport {
+	public:
+		size_t Owned   = 0; // jobs of the shard
+		size_t Resumed = 0; // already in results file
+		size_t Done    = 0; // run now
+	};
+
+	// Runs jobs of the shard and appends their results to the file in chunks,
+	// a file left by an interrupted run of the same shard is resumed:
+	// its complete records are kept, a partial last record is cut off.
+	template<size_t IMS, size_t RMS>
+	tuple<bool, string> run_shard(const Manifest& manifest, const Shard& shard, const string& path,
+		size_t default_max_ticks, Fleet::Executor<IMS, RMS>& executor, ShardReport& report) {
+		const size_t CHUNK = 256;
+		namespace fs = std::filesystem;
+
+		Header header;
+		header.RamSize    = RMS;
+		header.CpuSize    = IMS;
+		header.ShardIndex = uint32_t(shard.Index);
+		header.ShardCount = uint32_t(shard.Count);
+		header.JobCount   = manifest.Jobs.size();
+		header.RunKey     = get_run_key(manifest, default_max_ticks);
+		const auto record_size = get_record_size(IMS, RMS);
+
+		report = ShardReport();
+		vector<bool> done(manifest.Jobs.size(), false);
+		std::error_code ec;
+		if (fs::exists(path, ec) && (fs::file_size(path, ec) > 0)) {
+			size_t valid_size = HEADER_SIZE;
+			{
+				auto file = MappedFile(path);
+				if (!file.is_open()) {
+					return { false, "can't open file: " + path };
+				}
+				Header existing;
+				auto [ok, error] = read_header(file.data(), file.size(), SHARD_MAGIC, existing);
+				if (!ok) {
+					return { false, path + ": " + error };
+				}
+				if (!existing.same_run(header) || (existing.ShardIndex != header.ShardIndex)) {
+					return { false, path + ": results of another run or shard" };
+				}
+				for (; valid_size + record_size <= file.size(); valid_size += record_size) {
+					auto record = file.data() + valid_size;
+					auto index = Images::read_le<uint64_t>(record);
+					if (!is_valid_record(record, record_size) || (index >= done.size()) || !shard.owns(index)) {
+						break;
+					}
+					report.Resumed += done[index] ? 0 : 1;
+					done[index] = true;
+				}
+			}
+			fs::resize_file(path, valid_size, ec);
+			if (ec) {
+				return { false, "can't truncate file: " + path };
+			}
+		} else {
+			auto f = std::ofstream(path, std::ios::binary | std::ios::out | std::ios::trunc);
+			write_header(f, SHARD_MAGIC, header);
+			f.close();
+			if (f.fail()) {
+				return { false, "can't write file: " + path };
+			}
+		}
+
+		auto f = std::ofstream(path, std::ios::binary | std::ios::out | std::ios::app);
+		if (!f.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		vector<size_t> pending;
+		for (size_t i = shard.Index; i < manifest.Jobs.size(); i += shard.Count) {
+			report.Owned++;
+			if (!done[i]) {
+				pending.push_back(i);
+			}
+		}
+		for (size_t first = 0; first < pending.size(); first += CHUNK) {
+			auto last = std::min(first + CHUNK, pending.size());
+			vector<Fleet::Job<IMS, RMS>> jobs(last - first);
+			for (size_t i = first; i < last; i++) {
+				auto index = pending[i];
+				auto [ok, error] = make_job(manifest.Jobs[index], index, default_max_ticks, jobs[i - first]);
+				if (!ok) {
+					return { false, error };
+				}
+			}
+			for (const auto& result : executor.run(jobs)) {
+				write_record(f, result.Id, result);
+			}
+			f.flush();
+			if (f.fail()) {
+				return { false, "can't write file: " + path };
+			}
+			report.Done += jobs.size();
+		}
+		return { true, "" };
+	}
+
+	class MergeReport {
+	public:
+		size_t Jobs       = 0;
+		size_t Found      = 0;
+		size_t Duplicates = 0; // records of jobs already found, first one is kept
+		size_t Corrupted  = 0; // records with bad checksum or job index, skipped
+	};
+
+	// Combines shard files of one run into a merged file indexed by job,
+	// jobs missing in all shards have offset 0. The output is written
+	// to a temporary file first, so readers never see a partial result.
+	tuple<bool, string> merge(const vector<string>& inputs, const string& output, MergeReport& report) {
+		report = MergeReport();
+		if (inputs.empty()) {
+			return { false, "no shard files" };
+		}
+		vector<unique_ptr<MappedFile>> files;
+		Header run;
+		for (size_t i = 0; i < inputs.size(); i++) {
+			files.push_back(std::make_unique<MappedFile>(inputs[i]));
+			const auto& file = *files.back();
+			if (!file.is_open()) {
+				return { false, "can't open file: " + inputs[i] };
+			}
+			Header header;
+			auto [ok, error] = read_header(file.data(), file.size(), SHARD_MAGIC, header);
+			if (!ok) {
+				return { false, inputs[i] + ": " + error };
+			}
+			if (i == 0) {
+				run = header;
+			} else if (!header.same_run(run)) {
+				return { false, inputs[i] + ": results of another run" };
+			}
+			file.advise_sequential();
+		}
+
+		const auto record_size = get_record_size(run.CpuSize, run.RamSize);
+		vector<const uint8_t*> records(run.JobCount, nullptr);
+		for (const auto& file : files) {
+			auto data = file->data();
+			for (auto offset = HEADER_SIZE; offset + record_size <= file->size(); offset += record_size) {
+				auto record = data + offset;
+				auto index = Images::read_le<uint64_t>(record);
+				if (!is_valid_record(record, record_size) || (index >= run.JobCount)) {
+					report.Corrupted++;
+				} else if (records[index] != nullptr) {
+					report.Duplicates++;
+				} else {
+					records[index] = record;
+					report.Found++;
+				}
+			}
+		}
+		report.Jobs = run.JobCount;
+
+		auto temporary = output + ".tmp";
+		{
+			auto f = std::ofstream(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+			if (!f.is_open()) {
+				return { false, "can't open file: " + temporary };
+			}
+			auto header = run;
+			header.ShardIndex = 0;
+			write_header(f, MERGED_MAGIC, header);
+			uint64_t offset = HEADER_SIZE + run.JobCount * 8;
+			for (auto record : records) {
+				Images::write_le<uint64_t>(f, (record != nullptr) ? offset : 0);
+				offset += (record != nullptr) ? record_size : 0;
+			}
+			for (auto record : records) {
+				if (record != nullptr) {
+					f.write(reinterpret_cast<const char*>(record), record_size);
+				}
+			}
+			f.close();
+			if (f.fail()) {
+				return { false, "can't write file: " + temporary };
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(temporary, output, ec);
+		if (ec) {
+			return { false, "can't rename " + temporary + " to " + output };
+		}
+		return { true, "" };
+	}
+
+	// Random access to a merged file by job index
+	template<size_t IMS, size_t RMS>
+	class ResultFile {
+	public:
+		tuple<bool, string> open(const string& path) {
+			_file = std::make_unique<MappedFile>(path);
+			if (!_file->is_open()) {
+				return { false, "can't open file: " + path };
+			}
+			auto [ok, error] = read_header(_file->data(), _file->size(), MERGED_MAGIC, _header);
+			if (!ok) {
+				return { false, error };
+			}
+			if ((_header.CpuSize != IMS) || (_header.RamSize != RMS)) {
+				return { false, "memory sizes of results differ" };
+			}
+			if (_file->size() < HEADER_SIZE + _header.JobCount * 8) {
+				return { false, "results file is truncated" };
+			}
+			return { true, "" };
+		}
+
+		size_t size() const {
+			return size_t(_header.JobCount);
+		}
+
+		// False when the job is missing or its record is corrupted
+		bool get(size_t index, Fleet::Result<IMS, RMS>& result) const {
+			const auto record_size = get_record_size(IMS, RMS);
+			if (index >= size()) {
+				return false;
+			}
+			auto offset = Images::read_le<uint64_t>(_file->data() + HEADER_SIZE + index * 8);
+			if ((offset == 0) || (offset + record_size > _file->size())) {
+				return false;
+			}
+			auto record = _file->data() + offset;
+			if (!is_valid_record(record, record_size) || (Images::read_le<uint64_t>(record) != index)) {
+				return false;
+			}
+			read_record(record, result);
+			return true;
+		}
+
+	private:
+		unique_ptr<MappedFile> _file;
+		Header                 _header;
+	};
+}
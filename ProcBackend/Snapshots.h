@@ -0,0 +1,197 @@
+#pragma once
+
+#include <tuple>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#include "Hash.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "MemoryState.h"
+#include "Architecture.h"
+
+using std::tuple;
+using std::string;
+using std::shared_ptr;
+
+using Utils::MappedFile;
+using Architecture::NativeWord;
+using Architecture::WORD_SIZE;
+
+namespace Snapshots {
+	// Snapshot file layout, header numbers are little-endian:
+	//  0 char[4] magic "CPSN"
+	//  4 uint16  format version
+	//  6 uint16  word size in bits
+	//  8 uint32  RAM size in words
+	// 12 uint32  CPU memory size in words
+	// 16 uint32  words per memory page (State::PAGE_WORDS)
+	// 20 uint16  bytes per stored word
+	// 22 uint16  byte order mark, 0x0102 in byte order of the writer
+	// 24 uint32  probe size in bytes
+	// 28 uint32  reserved (0)
+	// 32 uint64  RAM section offset, multiple of FILE_ALIGN
+	// 40 uint64  file size
+	// 48 uint64  checksum of header bytes 0..47 and state section (FNV-1a)
+	// 56 uint64  checksum of RAM section (FNV-1a)
+	// 64 state section: CPU memory pages, control, address and data bus words, probe bytes
+	// RAM section: RAM memory pages
+	// Words are stored as in memory pages, so restored memory uses file pages without copying.
+	const char     MAGIC[4]    = { 'C', 'P', 'S', 'N' };
+	const uint16_t VERSION     = 1;
+	const uint16_t ORDER_MARK  = 0x0102;
+	const size_t   HEADER_SIZE = 64;
+	const size_t   FILE_ALIGN  = 4096;
+
+	template<size_t MS, class Memory>
+	void write_words(std::ostream& os, const Memory& memory) {
+		for (size_t i = 0; i < Memory::PAGED_SIZE; i++) {
+			auto word = (i < MS) ? NativeWord(memory.peek(i)) : NativeWord(0);
+			os.write(reinterpret_cast<const char*>(&word), sizeof(word));
+		}
+	}
+
+	template<class Probe>
+	void check_probe() {
+		static_assert(std::is_trivially_copyable_v<Probe>, "probe is saved as raw bytes");
+	}
+
+	// Writes full machine state: CPU memory (pipeline state included), buses, RAM and probe counters
+	template<class Machine>
+	tuple<bool, string> save(const string& path, const Machine& machine) {
+		using Probe = std::decay_t<decltype(machine.get_probe())>;
+		check_probe<Probe>();
+		const auto& state = machine.State;
+
+		std::ostringstream section;
+		write_words<Machine::CpuSize>(section, state.CPU);
+		write_words<1>(section, state.ControlBus);
+		write_words<1>(section, state.AddressBus);
+		write_words<1>(section, state.DataBus);
+		// Copied out first: an empty probe shares its address with the machine state
+		const Probe probe = machine.get_probe();
+		section.write(reinterpret_cast<const char*>(&probe), sizeof(Probe));
+		auto state_bytes = section.str();
+
+		std::ostringstream ram_section;
+		write_words<Machine::RamSize>(ram_section, state.RAM);
+		auto ram_bytes = ram_section.str();
+
+		auto ram_offset = (HEADER_SIZE + state_bytes.size() + FILE_ALIGN - 1) / FILE_ALIGN * FILE_ALIGN;
+		auto file_size  = ram_offset + ram_bytes.size();
+		auto byte_order = ORDER_MARK;
+
+		std::ostringstream header;
+		header.write(MAGIC, sizeof(MAGIC));
+		Images::write_le<uint16_t>(header, VERSION);
+		Images::write_le<uint16_t>(header, WORD_SIZE);
+		Images::write_le<uint32_t>(header, Machine::RamSize);
+		Images::write_le<uint32_t>(header, Machine::CpuSize);
+		Images::write_le<uint32_t>(header, State::PAGE_WORDS);
+		Images::write_le<uint16_t>(header, sizeof(NativeWord));
+		header.write(reinterpret_cast<const char*>(&byte_order), sizeof(byte_order));
+		Images::write_le<uint32_t>(header, sizeof(Probe));
+		Images::write_le<uint32_t>(header, 0);
+		Images::write_le<uint64_t>(header, ram_offset);
+		Images::write_le<uint64_t>(header, file_size);
+		auto prefix = header.str();
+		auto checksum = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(prefix.data()), prefix.size());
+		checksum = Utils::hash_bytes(reinterpret_cast<const uint8_t*>(state_bytes.data()), state_bytes.size(), checksum);
+		Images::write_le<uint64_t>(header, checksum);
+		Images::write_le<uint64_t>(header, Utils::hash_bytes(reinterpret_cast<const uint8_t*>(ram_bytes.data()), ram_bytes.size()));
+
+		auto f = std::ofstream(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!f.is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		f << header.str() << state_bytes << string(ram_offset - HEADER_SIZE - state_bytes.size(), '\0') << ram_bytes;
+		f.close();
+		if (f.fail()) {
+			return { false, "can't write file: " + path };
+		}
+		return { true, "" };
+	}
+
+	// Restores machine from snapshot file. The file is mapped privately and its pages become
+	// memory pages of the machine, so restore does not read RAM and file pages are loaded
+	// on first access, written pages are copied by the kernel. verify_ram checks RAM checksum too (reads all RAM).
+	template<class Machine>
+	tuple<bool, string> restore(const string& path, Machine& machine, bool verify_ram = false) {
+		using Probe = std::decay_t<decltype(machine.get_probe())>;
+		using Cpu   = std::decay_t<decltype(machine.State.CPU)>;
+		using Ram   = std::decay_t<decltype(machine.State.RAM)>;
+		using Bus   = State::ControlBusState;
+		check_probe<Probe>();
+
+		auto file = std::make_shared<MappedFile>(path, true);
+		if (!file->is_open()) {
+			return { false, "can't open file: " + path };
+		}
+		auto data = file->mutable_data();
+		auto size = file->size();
+		if ((size < HEADER_SIZE) || (data == nullptr) || (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)) {
+			return { false, "not a snapshot file" };
+		}
+		auto version    = Images::read_le<uint16_t>(data + 4);
+		auto word_size  = Images::read_le<uint16_t>(data + 6);
+		auto ram_size   = Images::read_le<uint32_t>(data + 8);
+		auto cpu_size   = Images::read_le<uint32_t>(data + 12);
+		auto page_words = Images::read_le<uint32_t>(data + 16);
+		auto word_bytes = Images::read_le<uint16_t>(data + 20);
+		auto probe_size = Images::read_le<uint32_t>(data + 24);
+		auto ram_offset = Images::read_le<uint64_t>(data + 32);
+		auto file_size  = Images::read_le<uint64_t>(data + 40);
+		auto checksum   = Images::read_le<uint64_t>(data + 48);
+		auto ram_sum    = Images::read_le<uint64_t>(data + 56);
+		uint16_t byte_order = 0;
+		std::memcpy(&byte_order, data + 22, sizeof(byte_order));
+
+		if (version != VERSION) {
+			return { false, "unsupported version " + std::to_string(version) };
+		}
+		if ((word_size != WORD_SIZE) || (word_bytes != sizeof(NativeWord)) || (byte_order != ORDER_MARK)) {
+			return { false, "word layout mismatch" };
+		}
+		if ((ram_size != Machine::RamSize) || (cpu_size != Machine::CpuSize) || (page_words != State::PAGE_WORDS)) {
+			return { false, "memory layout mismatch" };
+		}
+		if (probe_size != sizeof(Probe)) {
+			return { false, "probe layout mismatch" };
+		}
+		const auto state_size = (Cpu::PAGED_SIZE + 3 * Bus::PAGED_SIZE) * sizeof(NativeWord) + sizeof(Probe);
+		const auto ram_bytes  = Ram::PAGED_SIZE * sizeof(NativeWord);
+		if ((file_size != size) || (ram_offset % FILE_ALIGN != 0) || (ram_offset < HEADER_SIZE + state_size) || (size != ram_offset + ram_bytes)) {
+			return { false, "snapshot file is truncated" };
+		}
+		auto state_sum = Utils::hash_bytes(data, 48);
+		state_sum = Utils::hash_bytes(data + HEADER_SIZE, state_size, state_sum);
+		if (state_sum != checksum) {
+			return { false, "checksum mismatch" };
+		}
+		if (verify_ram && (Utils::hash_bytes(data + ram_offset, ram_bytes) != ram_sum)) {
+			return { false, "RAM checksum mismatch" };
+		}
+
+		auto owner = shared_ptr<void>(file);
+		auto words = reinterpret_cast<NativeWord*>(data + HEADER_SIZE);
+		auto& state = machine.State;
+		state.CPU.map_pages(words, owner);
+		words += Cpu::PAGED_SIZE;
+		state.ControlBus.poke(0, words[0]); // bus latches are copied
+		words += Bus::PAGED_SIZE;
+		state.AddressBus.poke(0, words[0]);
+		words += Bus::PAGED_SIZE;
+		state.DataBus.poke(0, words[0]);
+		words += Bus::PAGED_SIZE;
+		Probe probe;
+		std::memcpy(reinterpret_cast<void*>(&probe), words, sizeof(Probe));
+		machine.get_probe() = probe;
+		state.RAM.map_pages(reinterpret_cast<NativeWord*>(data + ram_offset), owner);
+		return { true, "" };
+	}
+}
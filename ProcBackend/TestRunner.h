@@ -2,20 +2,33 @@
 
 #include <set>
 #include <map>
+#include <mutex>
 #include <tuple>
+#include <chrono>
+#include <thread>
 #include <vector>
+#include <atomic>
+#include <iomanip>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <exception>
+#include <functional>
 #include <string_view>
+#include <condition_variable>
+
+#include "Logger.h"
 
 using std::set;
 using std::map;
 using std::cerr;
 using std::endl;
 
+using std::mutex;
 using std::tuple;
+using std::thread;
 using std::vector;
+using std::function;
 using std::ostream;
 using std::iostream;
 using std::exception;
@@ -95,44 +108,182 @@ namespace TestUtils {
 		assert_equal(b, true, hint);
 	}
 	
+	class TestCase {
+	public:
+		string           Name;
+		function<void()> Func;
+	};
+
+	class TestResult {
+	public:
+		string Name;
+		string Output;  // name, logs and outcome lines of the test
+		bool   Passed  = false;
+		double Seconds = 0;
+	};
+
+	// logs: test runs with all logs enabled, otherwise with logs disabled
+	TestResult run_test_case(const TestCase& test, bool logs = false) {
+		TestResult result;
+		result.Name = test.Name;
+		ostringstream os;
+		Utils::set_log_output(os);
+		if (logs) {
+			Utils::enable_all_logs();
+		} else {
+			Utils::disable_log();
+		}
+		os << test.Name << endl;
+		string error;
+		auto start = std::chrono::steady_clock::now();
+		try {
+			test.Func();
+			result.Passed = true;
+		}
+		catch (const exception& e) {
+			error = e.what();
+		}
+		catch (const exception* e) {
+			error = e->what();
+			delete e;
+		}
+		catch (...) {
+			error = "unknown exception";
+		}
+		result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		Utils::disable_log();
+		Utils::set_log_output(std::cout);
+		os << test.Name << (result.Passed ? " OK" : " fail: " + error);
+		os << " (" << std::fixed << std::setprecision(3) << result.Seconds << " s)" << endl << endl;
+		result.Output = os.str();
+		return result;
+	}
+
+	// Runs tests on threads (0 - hardware threads), each test starts with logs disabled
+	// (or all enabled with logs) and its output is buffered. Output is written in order of tests
+	// as soon as all tests before are done, so it is the same for any number of threads.
+	vector<TestResult> run_test_cases(const vector<TestCase>& tests, size_t threads, ostream& os, bool logs = false) {
+		threads = (threads == 0) ? thread::hardware_concurrency() : threads;
+		threads = std::max<size_t>(1, std::min(threads, tests.size()));
+		vector<TestResult> results(tests.size());
+		vector<bool> done(tests.size());
+		mutex done_mutex;
+		std::condition_variable done_changed;
+		std::atomic<size_t> next = { 0 };
+
+		vector<thread> workers;
+		for (size_t i = 0; i < threads; i++) {
+			workers.emplace_back([&]() {
+				for (auto index = next++; index < tests.size(); index = next++) {
+					auto result = run_test_case(tests[index], logs);
+					std::lock_guard<mutex> lock(done_mutex);
+					results[index] = std::move(result);
+					done[index] = true;
+					done_changed.notify_all();
+				}
+			});
+		}
+		for (size_t i = 0; i < tests.size(); i++) {
+			std::unique_lock<mutex> lock(done_mutex);
+			done_changed.wait(lock, [&]() { return done[i]; });
+			os << results[i].Output << std::flush;
+		}
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		return results;
+	}
+
+	// Collects tests of all runners made while it is active, run() runs them together
+	// and writes the slowest tests and totals. run() exits with code 1 when a test failed.
+	class TestSession {
+	public:
+		// threads: 0 - hardware threads, logs: run tests with all logs, slowest: tests in the slow list
+		TestSession(size_t threads = 0, bool logs = false, size_t slowest = 10):
+			_threads(threads), _logs(logs), _slowest(slowest) {
+			get_active() = this;
+		}
+
+		TestSession(const TestSession&) = delete;
+		TestSession& operator=(const TestSession&) = delete;
+
+		~TestSession() {
+			get_active() = nullptr;
+		}
+
+		static TestSession*& get_active() {
+			static TestSession* active = nullptr;
+			return active;
+		}
+
+		void add(TestCase&& test) {
+			_tests.push_back(std::move(test));
+		}
+
+		void run(ostream& os = cerr) {
+			auto start = std::chrono::steady_clock::now();
+			auto results = run_test_cases(_tests, _threads, os, _logs);
+			auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			_tests.clear();
+
+			size_t fail_count = 0;
+			double total = 0;
+			for (const auto& result : results) {
+				fail_count += result.Passed ? 0 : 1;
+				total += result.Seconds;
+			}
+			std::sort(results.begin(), results.end(), [](const TestResult& a, const TestResult& b) {
+				return (a.Seconds > b.Seconds) || ((a.Seconds == b.Seconds) && (a.Name < b.Name));
+			});
+			os << "Slowest tests:" << endl;
+			for (size_t i = 0; i < std::min(_slowest, results.size()); i++) {
+				os << "  " << std::fixed << std::setprecision(3) << results[i].Seconds << " s  " << results[i].Name << endl;
+			}
+			os << results.size() << " tests, " << std::setprecision(3) << total << " s in tests, " << wall << " s wall" << endl;
+			if (fail_count > 0) {
+				os << fail_count << " unit tests failed. Terminate." << endl;
+				exit(1);
+			}
+		}
+
+	private:
+		const size_t     _threads;
+		const bool       _logs;
+		const size_t     _slowest;
+		vector<TestCase> _tests;
+	};
+
+	// Tests of a group, named prefix.name. Added to the active session,
+	// or run when the runner is destroyed when there is no session.
 	class TestRunner {
 	public:
 		TestRunner(const string_view& prefix = "") :
 		_prefix(prefix) {}
 		
-		void write_name(const string_view& name) {
-			if (!_prefix.empty()) {
-				cerr << _prefix << ".";
-			}
-			cerr << name;
-		}
-		
 		template<class TestFunc>
 		void run_test(TestFunc func, const string_view& name) {
-			try {
-				write_name(name);
-				cerr << endl;
-				func();
-				write_name(name);
-				cerr << " OK" << endl << endl;
-			}
-			catch (runtime_error& e) {
-				++_fail_count;
-				write_name(name);
-				cerr << " fail: " << e.what() << endl << endl;
+			auto full_name = _prefix.empty() ? string(name) : string(_prefix) + "." + string(name);
+			auto test = TestCase { full_name, func };
+			if (auto session = TestSession::get_active()) {
+				session->add(std::move(test));
+			} else {
+				_tests.push_back(std::move(test));
 			}
 		}
 		
 		~TestRunner() {
-			if (_fail_count > 0) {
-				cerr << _fail_count << " unit tests failed. Terminate." << endl;
+			size_t fail_count = 0;
+			for (const auto& result : run_test_cases(_tests, 0, cerr)) {
+				fail_count += result.Passed ? 0 : 1;
+			}
+			if (fail_count > 0) {
+				cerr << fail_count << " unit tests failed. Terminate." << endl;
 				exit(1);
 			}
 		}
 		
 	private:
 		const string_view _prefix;
-		int               _fail_count = 0;
+		vector<TestCase>  _tests;
 	};
 }
-
@@ -2,10 +2,22 @@
 
 #include <array>
 #include <bitset>
+#include <random>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "TestRunner.h"
 
 #include "BitUtils.h"
+#include "BitSlice.h"
 #include "Reference.h"
 #include "CpuLogics.h"
 #include "RamRunner.h"
@@ -14,6 +26,20 @@
 #include "RegisterSet.h"
 #include "Architecture.h"
 #include "ComputerState.h"
+#include "Image.h"
+#include "Batch.h"
+#include "Fleet.h"
+#include "ResultCache.h"
+#include "Shards.h"
+#include "Ingestion.h"
+#include "Snapshots.h"
+#include "TimeTravel.h"
+#include "BusTrace.h"
+#include "LiveState.h"
+#include "MultiComputer.h"
+#include "DynamicComputer.h"
+#include "BoundedQueue.h"
+#include "Instrumentation.h"
 
 using std::array;
 using std::bitset;
@@ -39,16 +65,76 @@ using State::AddressBusState;
 using Architecture::WORD_SIZE;
 using Architecture::RegisterSet;
 using Architecture::MIN_MEMORY_SIZE;
+using Architecture::SERVICE_REGISTERS;
+using Instrumentation::Coverage;
+using Instrumentation::ProbeSet;
+using Instrumentation::AccessHeatmap;
+using Instrumentation::InstructionCounter;
+using Images::Image;
+using Images::Ingestion;
+using Utils::BoundedQueue;
 
 namespace Tests {
+	// Name is suffixed with process id, concurrent test runs don't touch each other's files
+	std::filesystem::path get_temp_path(const string& name) {
+	#ifdef _WIN32
+		auto pid = ::_getpid();
+	#else
+		auto pid = ::getpid();
+	#endif
+		return std::filesystem::temp_directory_path() / (name + "_" + std::to_string(pid));
+	}
+	
 	namespace Common {		
 		void assert_check() {
 			assert_true(true);
 		}
 		
+		void bounded_queue() {
+			BoundedQueue<int> queue(3);
+			assert_equal(queue.capacity(), 4u, "capacity");
+			int value = 0;
+			assert_true(!queue.try_pop(value), "empty");
+			for (int i = 0; i < 4; i++) {
+				assert_true(queue.try_push(i), "push");
+			}
+			value = 4;
+			assert_true(!queue.try_push(value), "full");
+			assert_true(queue.try_pop(value) && (value == 0), "fifo");
+			
+			const int producers = 4;
+			const int count = 10000;
+			BoundedQueue<int> shared(16);
+			vector<std::thread> threads;
+			for (int p = 0; p < producers; p++) {
+				threads.emplace_back([&shared]() {
+					for (int i = 1; i <= count; i++) {
+						auto item = i;
+						while (!shared.try_push(item)) {
+							std::this_thread::yield();
+						}
+					}
+				});
+			}
+			long long sum = 0;
+			for (int received = 0; received < producers * count; ) {
+				if (shared.try_pop(value)) {
+					sum += value;
+					received++;
+				} else {
+					std::this_thread::yield(); // producers may share the core
+				}
+			}
+			for (auto& t : threads) {
+				t.join();
+			}
+			assert_equal(sum, (long long)producers * count * (count + 1) / 2, "sum");
+		}
+		
 		void test() {
 			TestRunner tr("common");
 			tr.run_test(assert_check, "assert_check");
+			tr.run_test(bounded_queue, "bounded_queue");
 		}
 	}
 	
@@ -216,6 +302,50 @@ namespace Tests {
 			}
 		}
 		
+		void bit_sliced_exhaustive() {
+			using BitSlice::Operation;
+			// 16-bit widths take seconds, they are checked by "--bench bits"
+			for (auto operation : { Operation::Plus, Operation::Minus, Operation::Inverse }) {
+				auto max_width = (operation == Operation::Inverse) ? BitSlice::MAX_WIDTH : 10;
+				for (size_t width = 1; width <= max_width; width++) {
+					auto report = BitSlice::verify(operation, width);
+					auto name = string(BitSlice::to_string(operation)) + " width " + std::to_string(width);
+					assert_true(report.is_ok(), name + ": first mismatch " + std::to_string(report.FirstA) + ", " + std::to_string(report.FirstB));
+					auto pairs = (operation == Operation::Inverse) ? width : 2 * width;
+					assert_equal(report.Checked, uint64_t(1) << pairs, name + ": checked");
+				}
+			}
+		}
+		
+		// Every pair of 8-bit words, wider words are checked on edge values and random pairs
+		void bit_word_exhaustive() {
+			const uint64_t words = uint64_t(1) << WORD_SIZE;
+			vector<uint64_t> values;
+			if (WORD_SIZE <= 8) {
+				for (uint64_t a = 0; a < words; a++) {
+					values.push_back(a);
+				}
+			} else {
+				std::mt19937_64 random(5);
+				for (uint64_t edge : { uint64_t(0), uint64_t(1), uint64_t(2), words / 2 - 1, words / 2, words / 2 + 1, words - 2, words - 1 }) {
+					values.push_back(edge);
+				}
+				while (values.size() < 256) {
+					values.push_back(random() % words);
+				}
+			}
+			for (auto a : values) {
+				assert_equal(BitUtils::inverse(Word(a)), Word(~a), "inverse");
+				for (auto b : values) {
+					auto [sum, carry] = BitUtils::plus(Word(a), Word(b));
+					auto [diff, borrow] = BitUtils::minus(Word(a), Word(b));
+					if ((sum != Word(a + b)) || (carry != (a + b >= words)) || (diff != Word(a - b)) || (borrow != (a < b))) {
+						assert_true(false, std::to_string(a) + ", " + std::to_string(b));
+					}
+				}
+			}
+		}
+		
 		void test() {
 			TestRunner tr("bit_utils");
 			tr.run_test(bit_order, "bit_order");
@@ -228,6 +358,8 @@ namespace Tests {
 			tr.run_test(bit_inverse, "bit_inverse");
 			tr.run_test(bit_minus_ordinary, "bit_minus_ordinary");
 			tr.run_test(bit_minus_advanced, "bit_minus_advanced");
+			tr.run_test(bit_sliced_exhaustive, "bit_sliced_exhaustive");
+			tr.run_test(bit_word_exhaustive, "bit_word_exhaustive");
 		}
 	}
 	
@@ -287,11 +419,175 @@ namespace Tests {
 			assert_equal(after, BitUtils::get_flag(0));
 		}
 		
+		void computer_reset() {
+			auto ram = WordSet<3> { Word(Command::SET), Word(0x42), Word(0x00) };
+			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 3>(ram);
+			cmp.tick(5); // set: fetch, decode, read 1, read 2, execute
+			cmp.State.RAM.set_bits(WReference(0), Word(0xFF));
+			assert_equal(cmp.State.CPU[cmp.Registers.get_CN(0)], Word(0x42), "before");
+			
+			cmp.reset(ram);
+			auto fresh = Computer<MIN_MEMORY_SIZE + 1, 3>(ram);
+			assert_equal(cmp.State.CPU.get_all(), fresh.State.CPU.get_all(), "cpu");
+			assert_equal(cmp.State.RAM.get_all(), fresh.State.RAM.get_all(), "ram");
+			assert_equal(cmp.State.ControlBus.get_all(), fresh.State.ControlBus.get_all(), "control");
+			assert_equal(cmp.State.AddressBus.get_all(), fresh.State.AddressBus.get_all(), "address");
+			assert_equal(cmp.State.DataBus.get_all(), fresh.State.DataBus.get_all(), "data");
+		}
+		
+		void memory_copy_on_write() {
+			auto ms1 = MemoryState<130>("");
+			ms1.set_bits(WReference(0), Word(0x11));
+			auto ms2 = ms1;
+			auto shared = ms2.get_page_stats();
+			assert_equal(shared.Pages, 3u, "pages");
+			assert_equal(shared.Shared, 3u, "shared after copy");
+			assert_equal(shared.PrivateBytes, 0u, "bytes after copy");
+			
+			ms2.set_bits(WReference(129 * WORD_SIZE), Word(0x22));
+			assert_equal(ms1[WReference(129 * WORD_SIZE)], Word(0), "original");
+			assert_equal(ms2[WReference(129 * WORD_SIZE)], Word(0x22), "copy");
+			assert_equal(ms2[WReference(0)], Word(0x11), "not written page");
+			for (const auto& stats : { ms1.get_page_stats(), ms2.get_page_stats() }) {
+				assert_equal(stats.Shared, 2u, "shared");
+				assert_equal(stats.Private, 1u, "private");
+			}
+		}
+		
+		// 0x00: SET 0x42 0x00 => r[0] = 0x42
+		// 0x03: SET 0xC0 0x01 => r[1] = 0xC0
+		// 0x06: ST  0x00 0x01 => ram[0xC0] = 0x42
+		// 0x09: RST
+		WordSet<256> make_store_program() {
+			return {
+				Word(Command::SET), Word(0x42), Word(0x00),
+				Word(Command::SET), Word(0xC0), Word(0x01),
+				Word(Command::ST),  Word(0x00), Word(0x01),
+				Word(Command::RST),
+			};
+		}
+		
+		void computer_fork() {
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 256>(make_store_program());
+			cmp.tick(5); // first SET
+			auto fork = cmp.fork();
+			auto shared = fork.get_page_stats();
+			assert_equal(shared.Pages, 5u, "cpu and 4 ram pages, buses are not paged");
+			assert_equal(shared.Shared, 5u, "shared after fork");
+			
+			while (fork.tick()) { }
+			assert_equal(fork.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0x42), "fork stored");
+			assert_equal(cmp.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0), "original not stored");
+			auto written = fork.get_page_stats();
+			assert_equal(written.Shared, 3u, "not written ram pages");
+			
+			while (cmp.tick()) { }
+			assert_equal(cmp.State.CPU.get_all(), fork.State.CPU.get_all(), "cpu");
+			assert_equal(cmp.State.RAM.get_all(), fork.State.RAM.get_all(), "ram");
+		}
+		
+		void computer_snapshot_restore() {
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 256, InstructionCounter>(make_store_program());
+			cmp.tick(5);
+			auto snapshot = cmp.snapshot();
+			while (cmp.tick()) { }
+			auto done_cpu = cmp.State.CPU.get_all();
+			auto done_count = cmp.get_probe().Executed;
+			
+			cmp.restore(snapshot);
+			assert_equal(cmp.State.CPU.get_all(), snapshot.State.CPU.get_all(), "cpu restored");
+			assert_equal(cmp.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0), "ram restored");
+			assert_equal(cmp.get_probe().Executed, 1u, "probe restored");
+			
+			while (cmp.tick()) { }
+			assert_equal(cmp.State.CPU.get_all(), done_cpu, "cpu after rerun");
+			assert_equal(cmp.get_probe().Executed, done_count, "probe after rerun");
+			assert_equal(snapshot.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0), "snapshot unchanged");
+		}
+		
+		void computer_footprint() {
+			using Machine = Computer<MIN_MEMORY_SIZE + 2, 256>;
+			static_assert(std::is_empty_v<RegisterSet<MIN_MEMORY_SIZE + 2>>, "register layout is constant");
+			assert_equal(string(RegisterSet<MIN_MEMORY_SIZE + 2>::get_CN(1).FriendlyName), string("CR1"), "static name");
+			
+			auto cmp = Machine(make_store_program());
+			assert_true(cmp.get_instance_bytes() >= sizeof(Machine) + 256 * sizeof(NativeWord), "own ram");
+			auto fork = cmp.fork();
+			assert_equal(fork.get_instance_bytes(), sizeof(Machine), "fork owns no pages");
+			fork.tick(5);
+			assert_true(fork.get_instance_bytes() < sizeof(Machine) + 256 * sizeof(NativeWord), "ram pages stay shared");
+		}
+		
+		void sparse_memory() {
+			const size_t SIZE = 1 << 14;
+			auto dense  = MemoryState<SIZE>("");
+			auto sparse = MemoryState<SIZE, ::State::SparsePaging>("");
+			auto empty = sparse.get_page_stats();
+			assert_equal(empty.Pages, dense.get_page_stats().Pages, "pages");
+			assert_equal(empty.Shared, empty.Pages, "zero pages are shared");
+			assert_equal(empty.PrivateBytes, 0u, "no memory before write");
+			
+			std::mt19937 random(7);
+			for (size_t i = 0; i < 200; i++) {
+				auto address = (i % 2 == 0) ? random() % 512 : random() % SIZE; // dense start, scattered tail
+				auto value = Word(random());
+				dense.set_bits(WReference(address * WORD_SIZE), value);
+				sparse.set_bits(WReference(address * WORD_SIZE), value);
+			}
+			dense.set_bits(Reference<2>(WORD_SIZE - 1), bitset<2>(0b11)); // across words
+			sparse.set_bits(Reference<2>(WORD_SIZE - 1), bitset<2>(0b11));
+			assert_equal(sparse.get_all(), dense.get_all(), "same words");
+			for (size_t i = 0; i < SIZE; i += 97) {
+				assert_equal(sparse.peek(i), dense.peek(i), "peek");
+			}
+			auto written = sparse.get_page_stats();
+			assert_true(written.Private <= 200, "only written pages are private");
+			assert_true(written.PrivateBytes < dense.get_page_stats().PrivateBytes / 2, "memory follows written pages");
+			
+			auto copy = sparse;
+			copy.set_bits(WReference((SIZE - 1) * WORD_SIZE), Word(0x5A));
+			assert_equal(sparse.peek(SIZE - 1), dense.peek(SIZE - 1), "original after copy write");
+			assert_equal(copy.peek(SIZE - 1), 0x5Au, "copy");
+			
+			auto init = WordSet<SIZE> { };
+			init[3] = Word(0x33);
+			sparse.load(init);
+			assert_equal(sparse.peek(3), 0x33u, "loaded");
+			assert_equal(sparse.get_page_stats().Private, 1u, "zero words are not stored");
+			sparse.clear();
+			assert_equal(sparse.get_page_stats().PrivateBytes, 0u, "clear");
+			assert_equal(sparse.get_all(), MemoryState<SIZE>("").get_all(), "cleared words");
+		}
+		
+		void sparse_computer() {
+			using SparseMachine = Computer<MIN_MEMORY_SIZE + 2, 256, Instrumentation::NoProbe, ::State::SparsePaging>;
+			auto dense  = Computer<MIN_MEMORY_SIZE + 2, 256>(make_store_program());
+			auto sparse = SparseMachine(make_store_program());
+			sparse.tick(5);
+			auto fork = sparse.fork();
+			while (dense.tick()) { }
+			while (fork.tick()) { }
+			assert_equal(fork.State.CPU.get_all(), dense.State.CPU.get_all(), "cpu");
+			assert_equal(fork.State.RAM.get_all(), dense.State.RAM.get_all(), "ram");
+			assert_equal(sparse.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0), "original not stored");
+			
+			auto ram = fork.State.RAM.get_page_stats();
+			assert_equal(ram.Private, 1u, "stored page");
+			assert_equal(ram.Shared, 3u, "program page and zero pages");
+		}
+		
 		void test() {
 			TestRunner tr("state");
 			tr.run_test(memory_state, "memory_state");
 			tr.run_test(computer_state, "computer_state");
 			tr.run_test(overflow_always_saved, "overflow_always_saved");
+			tr.run_test(computer_reset, "computer_reset");
+			tr.run_test(memory_copy_on_write, "memory_copy_on_write");
+			tr.run_test(computer_fork, "computer_fork");
+			tr.run_test(computer_snapshot_restore, "computer_snapshot_restore");
+			tr.run_test(computer_footprint, "computer_footprint");
+			tr.run_test(sparse_memory, "sparse_memory");
+			tr.run_test(sparse_computer, "sparse_computer");
 		}
 	}
 	
@@ -315,9 +611,9 @@ namespace Tests {
 		void cpu_logics() {
 			RegisterSet<MIN_MEMORY_SIZE + 2> regs;
 			MemoryState<MIN_MEMORY_SIZE + 2> cpu("");
-			ControlBusState                  control("");
-			DataBusState                     data("");
-			AddressBusState                  address("");
+			ControlBusState                  control;
+			DataBusState                     data;
+			AddressBusState                  address;
 			
 			CpuLogics<MIN_MEMORY_SIZE + 2>   logics(regs, cpu, control, data, address);
 			
@@ -336,9 +632,9 @@ namespace Tests {
 		
 		void ram_runner_read() {
 			auto ram = MemoryState<1>("", { 0b1111 } );
-			auto db = DataBusState("");
-			auto cb = ControlBusState("");
-			auto ab = AddressBusState("");
+			auto db = DataBusState();
+			auto cb = ControlBusState();
+			auto ab = AddressBusState();
 			RamRunner<1> runner(cb, ab, db, ram);
 			auto before = db[WReference(0)];
 			assert_equal(before, BitUtils::get_zero());
@@ -350,9 +646,9 @@ namespace Tests {
 		
 		void ram_runner_write() {
 			auto ram = MemoryState<1>("");
-			auto db = DataBusState("");
-			auto cb = ControlBusState("");
-			auto ab = AddressBusState("");
+			auto db = DataBusState();
+			auto cb = ControlBusState();
+			auto ab = AddressBusState();
 			RamRunner<1> runner(cb, ab, db, ram);
 			auto data = Word(0b1111);
 			auto before = ram[WReference(0)];
@@ -364,11 +660,28 @@ namespace Tests {
 			assert_equal(after, data);
 		}
 		
+		void ram_runner_out_of_range() {
+			auto ram = MemoryState<1>("", { 0b1111 } );
+			auto db = DataBusState();
+			auto cb = ControlBusState();
+			auto ab = AddressBusState();
+			RamRunner<1> runner(cb, ab, db, ram);
+			ab.set_bits(WReference(0), Word(0x10));
+			db.set_bits(WReference(0), Word(0b1010));
+			cb.set_bits(WReference(0), Word(0b11));
+			runner.tick();
+			assert_equal(ram[WReference(0)], Word(0b1111), "write ignored");
+			cb.set_bits(WReference(0), Word(0b01));
+			runner.tick();
+			assert_equal(db[WReference(0)], BitUtils::get_zero(), "read zero");
+		}
+		
 		void test() {
 			TestRunner tr("logics");
 			tr.run_test(cpu_logics, "cpu_logics");
 			tr.run_test(ram_runner_read, "ram_runner_read");
 			tr.run_test(ram_runner_write, "ram_runner_write");
+			tr.run_test(ram_runner_out_of_range, "ram_runner_out_of_range");
 		}
 	}
 	
@@ -653,13 +966,14 @@ namespace Tests {
 		}
 		
 		void LDA() {
-			// desc: LDA   x    mem
-			// addr: 0000 0001 0010
-			// data: 0x10 0011 0110
-			// x - address in ram
-			// expected: read mem at 0011 (0110) to AR
+			// desc: LDA  x    _    mem
+			// addr: 0000 0001 0010 0011
+			// data: 0x10 0000 0000 0110
+			// r[0] = 0011
+			// expected: read mem at r[0] (0110) to AR
 			
-			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 3>( { Command::LD, 0b11, 0b110 } );
+			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 4>( { Command::LDA, 0b0, 0b0, 0b110 } );
+			cmp.State.CPU.set_bits(cmp.Registers.get_CN(0), Word(0b11));
 			auto ar = cmp.Registers.AR;
 			
 			auto before = cmp.State.CPU[ar];
@@ -672,12 +986,13 @@ namespace Tests {
 		}
 		
 		void STA() {
-			// desc: ST   x    mem
+			// desc: STA  x    mem
 			// addr: 0000 0001 0010
-			// data: 0x11 0001 0000
-			// ar = 0110
-			// expected: write from ar to mem at y
-			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 3>( { Command::ST, 0b10, 0b0 } );
+			// data: 0x11 0000 0000
+			// r[0] = 0010, ar = 0110
+			// expected: write from ar to mem at r[0]
+			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 3>( { Command::STA, 0b0, 0b0 } );
+			cmp.State.CPU.set_bits(cmp.Registers.get_CN(0), Word(0b10));
 			auto ar = cmp.Registers.AR;
 			cmp.State.CPU.set_bits(ar, Word(0b0110));
 			
@@ -780,14 +1095,1485 @@ namespace Tests {
 			tr.run_test(DEC, "DEC");
 			tr.run_test(DECA, "DECA");
 			tr.run_test(JMP, "JMP");
-			tr.run_test(JMP, "LDA");
-			tr.run_test(JMP, "STA");
+			tr.run_test(LDA, "LDA");
+			tr.run_test(STA, "STA");
 			tr.run_test(CMP, "CMP");
 			tr.run_test(JZ, "JZ");
 			tr.run_test(SET, "SET");
 		}
 	}
 	
+	namespace Instrumentation {
+		void access_heatmap() {
+			// 0x00: SET 0x0B 0x00 => r[0] = 0x0B
+			// 0x03: ST  0x01 0x00 => ram[r[0]] = r[1]
+			// 0x06: LD  0x00 0x01 => r[1] = ram[r[0]]
+			// 0x09: RST
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 12, AccessHeatmap<12>>({
+				Word(Command::SET), Word(0x0B), Word(0x00),
+				Word(Command::ST),  Word(0x01), Word(0x00),
+				Word(Command::LD),  Word(0x00), Word(0x01),
+				Word(Command::RST),
+			});
+			cmp.tick(32);
+			assert_equal(cmp.State.CPU[cmp.Registers.Terminated], BitUtils::get_flag(true), "terminated");
+			
+			auto& heatmap = cmp.get_probe();
+			for (size_t i = 0; i < 10; i++) {
+				assert_equal(heatmap.Fetches[i], 1u, "fetch " + std::to_string(i));
+				assert_equal(heatmap.Reads[i],   0u, "read " + std::to_string(i));
+				assert_equal(heatmap.Writes[i],  0u, "write " + std::to_string(i));
+			}
+			assert_true(!heatmap.is_touched(10), "untouched");
+			assert_equal(heatmap.Writes[11], 1u, "data write");
+			assert_equal(heatmap.Reads[11],  1u, "data read");
+			assert_true(heatmap.FirstTick[11] < heatmap.LastTick[11], "write before read");
+			
+			auto ws = heatmap.get_working_set();
+			assert_equal(ws.Touched, 11u, "touched");
+			assert_equal(ws.ReadOnly, 10u, "read-only");
+			assert_equal(ws.Written, 1u, "written");
+			assert_equal(ws.Regions.size(), 2u, "regions");
+			assert_equal(ws.Regions[0].Last, 9u, "code region");
+			assert_true(ws.Regions[1].Written, "data region");
+		}
+		
+		void coverage() {
+			// 0x00: CMP 0x00 0x01 => ZF = 1
+			// 0x03: JZ  0x06      => taken
+			// 0x05: NOOP          => skipped
+			// 0x06: SET 0x01 0x00 => r[0] = 1
+			// 0x09: CMP 0x00 0x01 => ZF = 0
+			// 0x0C: JZ  0x05      => not taken
+			// 0x0E: RST
+			using Probes = ProbeSet<Coverage<15>, AccessHeatmap<15>>;
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 15, Probes>({
+				Word(Command::CMP), Word(0x00), Word(0x01),
+				Word(Command::JZ),  Word(0x06),
+				Word(Command::NOOP),
+				Word(Command::SET), Word(0x01), Word(0x00),
+				Word(Command::CMP), Word(0x00), Word(0x01),
+				Word(Command::JZ),  Word(0x05),
+				Word(Command::RST),
+			});
+			while (cmp.tick()) {}
+			cmp.tick(); // no more events after termination
+			
+			const auto& cov = cmp.get_probe().get<Coverage<15>>();
+			assert_equal(cov.count_addresses(), 6u, "addresses");
+			assert_true(cov.is_executed(0x00) && cov.is_executed(0x03) && cov.is_executed(0x0E), "executed");
+			assert_true(!cov.is_executed(0x05), "skipped");
+			assert_equal(cov.count_commands(), 4u, "commands");
+			assert_true(cov.is_command_executed(Command::SET) && !cov.is_command_executed(Command::NOOP), "command set");
+			assert_true(cov.is_jz_taken(0x03) && !cov.is_jz_not_taken(0x03), "jz taken");
+			assert_true(cov.is_jz_not_taken(0x0C) && !cov.is_jz_taken(0x0C), "jz not taken");
+			assert_equal(cmp.get_probe().get<AccessHeatmap<15>>().Fetches[0x05], 0u, "heatmap in probe set");
+			
+			Coverage<15> total;
+			assert_true(cov.has_new(total), "new for empty");
+			stringstream ss;
+			cov.write(ss);
+			assert_true(total.read(ss), "read");
+			assert_true(!cov.has_new(total), "round trip");
+			Coverage<15> other;
+			other.on_execute(0x05, Command::NOOP, false);
+			assert_true(other.has_new(total), "other is new");
+			total.merge(other);
+			assert_equal(total.count_addresses(), 7u, "merged");
+			
+			Coverage<15> invalid;
+			invalid.on_execute(0x00, 0xFF, false);
+			invalid.on_execute(0x01, ::Logics::WordLayout::COMMAND_COUNT, false);
+			assert_true(invalid.is_invalid_command_executed() && !invalid.is_command_executed(0xFF), "invalid code");
+			assert_equal(invalid.count_commands(), 0u, "invalid codes are not commands");
+			assert_true(invalid.has_new(total), "invalid is new");
+		}
+		
+		void test() {
+			TestRunner tr("instrumentation");
+			tr.run_test(access_heatmap, "access_heatmap");
+			tr.run_test(coverage, "coverage");
+		}
+	}
+	
+	namespace Images {
+		template<size_t RMS>
+		auto parse_text(const string& text) {
+			WordSet<RMS> ram = { };
+			auto count = ::Images::parse_text(reinterpret_cast<const uint8_t*>(text.data()), text.size(), ram);
+			return tuple { count, ram };
+		}
+		
+		// Digits of the word, most significant first, split after first digits
+		string digits(size_t value, size_t first = WORD_SIZE, const string& separator = "") {
+			auto text = Word(value).to_string();
+			return text.substr(0, first) + separator + text.substr(first);
+		}
+		
+		void text_format() {
+			{
+				auto [count, ram] = parse_text<4>(digits(0x0F, 4, " ") + "\n" + digits(0x13, 4, " ") + "\n");
+				assert_equal(count, 2u, "count #1");
+				assert_equal(ram[0], Word(0x0F), "msb first");
+				assert_equal(ram[1], Word(0x13), "second word");
+			}
+			{
+				// whole-digit blocks, garbage between words, tail shorter than block
+				auto [count, ram] = parse_text<4>(digits(0x81) + "xx" + digits(0x55) + " ;" + digits(0xF0, WORD_SIZE - 4, " "));
+				assert_equal(count, 3u, "count #2");
+				assert_equal(ram[0], Word(0x81), "block");
+				assert_equal(ram[1], Word(0x55), "unaligned block");
+				assert_equal(ram[2], Word(0xF0), "tail");
+			}
+			{
+				auto [count, ram] = parse_text<2>(digits(1) + " " + digits(2) + " " + digits(3));
+				assert_equal(count, 2u, "stops at RMS");
+				assert_equal(ram[1], Word(0x02), "last word");
+			}
+		}
+		
+		void binary_format() {
+			Image<MIN_MEMORY_SIZE + 1, 3> image;
+			image.Ram       = { Word(Command::INC), Word(0x00), Word(Command::RST) };
+			image.Registers = { };
+			image.Registers[MIN_MEMORY_SIZE] = Word(0x41);
+			image.EntryIP   = 0;
+			
+			stringstream ss;
+			::Images::write_binary(ss, image);
+			auto data = ss.str();
+			auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+			assert_equal(data.size(), ::Images::HEADER_SIZE + (MIN_MEMORY_SIZE + 1 + 3) * WORD_BYTES, "size");
+			
+			Image<MIN_MEMORY_SIZE + 1, 4> loaded;
+			auto [ok, error] = ::Images::parse(bytes, data.size(), loaded);
+			assert_true(ok, error);
+			assert_equal(loaded.Ram[0], Word(Command::INC), "ram");
+			assert_equal(loaded.Ram[3], Word(0), "zero extended");
+			assert_equal(loaded.Registers[MIN_MEMORY_SIZE], Word(0x41), "register");
+			
+			auto cmp = Computer<MIN_MEMORY_SIZE + 1, 4>(loaded.Ram);
+			loaded.apply(cmp);
+			cmp.tick(4); // inc: fetch, decode, read 1, execute
+			assert_equal(cmp.State.CPU[cmp.Registers.get_CN(0)], Word(0x42), "applied");
+			
+			data[::Images::HEADER_SIZE] ^= 1;
+			auto [corrupted_ok, corrupted_error] = ::Images::parse(bytes, data.size(), loaded);
+			assert_true(!corrupted_ok, "checksum");
+			
+			Image<MIN_MEMORY_SIZE + 1, 2> small;
+			auto [small_ok, small_error] = ::Images::parse(bytes, data.size(), small);
+			assert_true(!small_ok, "does not fit");
+			
+			image.EntryIP = 4;
+			stringstream out_of_ram;
+			::Images::write_binary(out_of_ram, image);
+			auto entry_data = out_of_ram.str();
+			auto [entry_ok, entry_error] = ::Images::parse(reinterpret_cast<const uint8_t*>(entry_data.data()), entry_data.size(), loaded);
+			assert_true(!entry_ok, "entry ip out of ram");
+		}
+		
+		void ingestion() {
+			namespace fs = std::filesystem;
+			auto dir = get_temp_path("cpp_proc_ingestion_test");
+			fs::remove_all(dir);
+			fs::create_directories(dir / "images");
+			const size_t count = 20;
+			for (size_t i = 0; i < count; i++) {
+				auto f = std::ofstream(dir / "images" / ("image_" + std::to_string(100 + i) + ".txt"));
+				f << Word(i) << "\n";
+			}
+			{
+				auto f = std::ofstream(dir / "manifest.txt");
+				f << "# comment\n\nimages/image_101.txt\nimages/missing.txt\n";
+			}
+			
+			vector<string> paths;
+			auto [listed, list_error] = ::Images::list_sources((dir / "images").string(), paths);
+			assert_true(listed, list_error);
+			assert_equal(paths.size(), count, "listed");
+			vector<bool> seen(count, false);
+			{
+				Ingestion<MIN_MEMORY_SIZE, 2> ingestion(paths, 3, 4);
+				Ingestion<MIN_MEMORY_SIZE, 2>::Item item;
+				while (ingestion.pop(item)) {
+					assert_true(item.Ok, item.Error);
+					assert_equal(item.Value.Ram[0], Word(item.Index), item.Path);
+					seen[item.Index] = true;
+				}
+			}
+			assert_equal(static_cast<size_t>(std::count(seen.begin(), seen.end(), true)), count, "all ingested");
+			
+			vector<string> manifest;
+			auto [manifest_ok, manifest_error] = ::Images::list_sources((dir / "manifest.txt").string(), manifest);
+			assert_true(manifest_ok, manifest_error);
+			assert_equal(manifest.size(), 2u, "manifest");
+			{
+				Ingestion<MIN_MEMORY_SIZE, 2> ingestion(manifest, 2, 2);
+				Ingestion<MIN_MEMORY_SIZE, 2>::Item item;
+				size_t failed = 0;
+				while (ingestion.pop(item)) {
+					failed += item.Ok ? 0 : 1;
+				}
+				assert_equal(failed, 1u, "missing file");
+			}
+			
+			vector<string> missing;
+			auto [missing_ok, missing_error] = ::Images::list_sources((dir / "missing").string(), missing);
+			assert_true(!missing_ok, "missing source");
+			fs::remove_all(dir);
+		}
+		
+		void test() {
+			TestRunner tr("images");
+			tr.run_test(text_format, "text_format");
+			tr.run_test(binary_format, "binary_format");
+			tr.run_test(ingestion, "ingestion");
+		}
+	}
+	
+	namespace Snapshots {
+		using Machine = Computer<MIN_MEMORY_SIZE + 2, 256, InstructionCounter>;
+		
+		void flip_byte(const string& path, size_t offset) {
+			auto f = std::fstream(path, std::ios::binary | std::ios::in | std::ios::out);
+			f.seekg(offset);
+			auto c = static_cast<char>(f.get());
+			f.seekp(offset);
+			f.put(static_cast<char>(c ^ 1));
+		}
+		
+		void save_restore() {
+			namespace fs = std::filesystem;
+			auto path = get_temp_path("cpp_proc_snapshot_test").string() + ".snap";
+			auto cmp = Machine(State::make_store_program());
+			cmp.tick(11); // two SETs and fetch of ST
+			auto [saved, save_error] = ::Snapshots::save(path, cmp);
+			assert_true(saved, save_error);
+			assert_equal((fs::file_size(path) - 256 * sizeof(NativeWord)) % ::Snapshots::FILE_ALIGN, 0u, "ram section is page aligned");
+			
+			auto restored = Machine(WordSet<256> { });
+			auto [ok, error] = ::Snapshots::restore(path, restored, true);
+			assert_true(ok, error);
+			assert_equal(restored.State.CPU.get_all(), cmp.State.CPU.get_all(), "cpu");
+			assert_equal(restored.State.RAM.get_all(), cmp.State.RAM.get_all(), "ram");
+			assert_equal(restored.State.ControlBus.get_all(), cmp.State.ControlBus.get_all(), "control");
+			assert_equal(restored.State.AddressBus.get_all(), cmp.State.AddressBus.get_all(), "address");
+			assert_equal(restored.State.DataBus.get_all(), cmp.State.DataBus.get_all(), "data");
+			assert_equal(restored.get_probe().Executed, cmp.get_probe().Executed, "probe");
+			auto mapped = restored.get_page_stats();
+			assert_equal(mapped.Shared, 0u, "mapped pages are not shared");
+			auto fork = restored.fork();
+			fork.State.RAM.set_bits(WReference(0), Word(0x5A));
+			assert_equal(restored.State.RAM[WReference(0)], Word(Command::SET), "fork writes a copy");
+			assert_equal(restored.get_page_stats().Shared, mapped.Pages - 1, "only written page is private");
+			
+			while (cmp.tick()) { }
+			while (restored.tick()) { }
+			assert_equal(restored.State.CPU.get_all(), cmp.State.CPU.get_all(), "cpu after run");
+			assert_equal(restored.State.RAM[WReference(0xC0 * WORD_SIZE)], Word(0x42), "ram after run");
+			assert_equal(restored.get_probe().Executed, cmp.get_probe().Executed, "probe after run");
+			
+			auto other = Computer<MIN_MEMORY_SIZE + 2, 128, InstructionCounter>(WordSet<128> { });
+			auto [other_ok, other_error] = ::Snapshots::restore(path, other);
+			assert_true(!other_ok, "ram size");
+			auto plain = Computer<MIN_MEMORY_SIZE + 2, 256>(WordSet<256> { });
+			auto [plain_ok, plain_error] = ::Snapshots::restore(path, plain);
+			assert_true(!plain_ok, "probe");
+			
+			flip_byte(path, fs::file_size(path) - 1);
+			auto [lazy_ok, lazy_error] = ::Snapshots::restore(path, restored);
+			assert_true(lazy_ok, "ram is not read without verification");
+			auto [ram_ok, ram_error] = ::Snapshots::restore(path, restored, true);
+			assert_true(!ram_ok, "ram checksum");
+			
+			flip_byte(path, ::Snapshots::HEADER_SIZE);
+			auto [state_ok, state_error] = ::Snapshots::restore(path, restored);
+			assert_true(!state_ok, "state checksum");
+			fs::remove(path);
+		}
+		
+		void test() {
+			TestRunner tr("snapshots");
+			tr.run_test(save_restore, "save_restore");
+		}
+	}
+	
+	namespace TimeTravel {
+		const size_t IMS = MIN_MEMORY_SIZE + 3;
+		const size_t RMS = 256;
+		using Machine  = Computer<IMS, RMS>;
+		using Timeline = ::TimeTravel::Timeline<IMS, RMS>;
+		
+		// 0x00: SET 0x20 0x00 => r[0] = 32
+		// 0x03: SET 0x00 0x01 => r[1] = 0
+		// 0x06: SET 0x80 0x02 => r[2] = 0x80
+		// 0x09: ST  0x00 0x02 => ram[r[2]] = r[0]
+		// 0x0C: INC 0x02
+		// 0x0E: DEC 0x00
+		// 0x10: CMP 0x00 0x01
+		// 0x13: JZ  0x17
+		// 0x15: JMP 0x09
+		// 0x17: RST
+		WordSet<RMS> make_fill_program() {
+			return {
+				Word(Command::SET), Word(0x20), Word(0x00),
+				Word(Command::SET), Word(0x00), Word(0x01),
+				Word(Command::SET), Word(0x80), Word(0x02),
+				Word(Command::ST),  Word(0x00), Word(0x02),
+				Word(Command::INC), Word(0x02),
+				Word(Command::DEC), Word(0x00),
+				Word(Command::CMP), Word(0x00), Word(0x01),
+				Word(Command::JZ),  Word(0x17),
+				Word(Command::JMP), Word(0x09),
+				Word(Command::RST),
+			};
+		}
+		
+		// States after every tick till termination
+		vector<Machine> run_reference() {
+			vector<Machine> states = { Machine(make_fill_program()) };
+			auto cmp = states.back().fork();
+			auto running = true;
+			while (running) {
+				running = cmp.tick();
+				states.push_back(cmp.fork());
+			}
+			return states;
+		}
+		
+		void assert_same(const Machine& actual, const Machine& expected, const string& hint) {
+			assert_equal(actual.State.CPU.get_all(), expected.State.CPU.get_all(), hint + " cpu");
+			assert_equal(actual.State.RAM.get_all(), expected.State.RAM.get_all(), hint + " ram");
+			assert_equal(actual.State.ControlBus.get_all(), expected.State.ControlBus.get_all(), hint + " control");
+			assert_equal(actual.State.AddressBus.get_all(), expected.State.AddressBus.get_all(), hint + " address");
+			assert_equal(actual.State.DataBus.get_all(), expected.State.DataBus.get_all(), hint + " data");
+		}
+		
+		void seek() {
+			auto reference = run_reference();
+			auto last = reference.size() - 1;
+			::TimeTravel::Limits limits;
+			limits.CheckpointInterval = 16;
+			auto timeline = Timeline(make_fill_program(), limits);
+			while (timeline.tick()) { }
+			assert_equal(timeline.get_tick(), last, "ticks");
+			assert_equal(timeline.get_first_tick(), 0u, "nothing forgotten");
+			
+			std::mt19937 random(7);
+			for (size_t i = 0; i < 200; i++) {
+				auto target = random() % (last + 1);
+				auto [ok, error] = timeline.seek(target);
+				assert_true(ok, error);
+				assert_equal(timeline.get_tick(), target, "seek tick");
+				assert_same(timeline.get_computer(), reference[target], "seek " + std::to_string(target));
+			}
+			
+			timeline.seek(100);
+			auto [back_ok, back_error] = timeline.step_back(3);
+			assert_true(back_ok, back_error);
+			assert_same(timeline.get_computer(), reference[97], "step back");
+			assert_true(timeline.tick(), "replayed tick");
+			assert_same(timeline.get_computer(), reference[98], "replay");
+			
+			timeline.seek(last - 1);
+			assert_true(!timeline.tick(), "replayed termination");
+			auto [before_ok, before_error] = timeline.step_back(last + 1);
+			assert_true(!before_ok, "before tick 0");
+		}
+		
+		void seek_past_termination() {
+			auto reference = run_reference();
+			auto last = reference.size() - 1;
+			auto timeline = Timeline(make_fill_program());
+			auto [ok, error] = timeline.seek(last + 1000);
+			assert_true(!ok, "seek past termination");
+			assert_equal(timeline.get_tick(), last, "stopped at termination");
+			assert_same(timeline.get_computer(), reference[last], "terminated");
+			
+			auto [again_ok, again_error] = timeline.seek(last + 1);
+			assert_true(!again_ok, "seek after termination");
+			assert_equal(timeline.get_tick(), last, "no tick after termination");
+			auto [back_ok, back_error] = timeline.seek(last / 2);
+			assert_true(back_ok, back_error);
+			assert_same(timeline.get_computer(), reference[last / 2], "back from termination");
+		}
+		
+		void bounded() {
+			auto reference = run_reference();
+			auto last = reference.size() - 1;
+			::TimeTravel::Limits limits;
+			limits.MaxTicks = 50;
+			limits.MaxDeltas = 120;
+			limits.CheckpointInterval = 8;
+			auto timeline = Timeline(make_fill_program(), limits);
+			while (timeline.tick()) { }
+			auto first = timeline.get_first_tick();
+			assert_true(first >= last - 50, "ticks limit");
+			assert_true(timeline.get_delta_count() <= 120, "deltas limit");
+			assert_true(timeline.get_checkpoint_count() <= 50 / 8 + 1, "checkpoints");
+			
+			auto [forgotten_ok, forgotten_error] = timeline.seek(first - 1);
+			assert_true(!forgotten_ok, "forgotten");
+			auto [ok, error] = timeline.seek(first);
+			assert_true(ok, error);
+			assert_same(timeline.get_computer(), reference[first], "first");
+			timeline.seek(last);
+			assert_same(timeline.get_computer(), reference[last], "last");
+		}
+		
+		void test() {
+			TestRunner tr("time_travel");
+			tr.run_test(seek, "seek");
+			tr.run_test(seek_past_termination, "seek_past_termination");
+			tr.run_test(bounded, "bounded");
+		}
+	}
+	
+	namespace BusTrace {
+		using Machine = TimeTravel::Machine;
+		
+		void record_replay() {
+			auto cmp = Machine(TimeTravel::make_fill_program());
+			auto trace = ::BusTrace::record(cmp);
+			assert_true(cmp.State.CPU[cmp.Registers.Terminated].test(0), "terminated");
+			assert_equal(trace.InitialRam.size(), TimeTravel::RMS, "initial ram");
+			auto writes = std::count_if(trace.Transactions.begin(), trace.Transactions.end(),
+				[](const ::BusTrace::Transaction& transaction) { return transaction.Write; });
+			assert_equal(writes, 0x20, "writes");
+			
+			vector<NativeWord> ram;
+			auto [ok, error] = ::BusTrace::replay(trace, ram);
+			assert_true(ok, error);
+			for (size_t i = 0; i < TimeTravel::RMS; i++) {
+				assert_equal(size_t(ram[i]), cmp.State.RAM.peek(i), "final ram");
+			}
+			
+			trace.Transactions[0].Data ^= 1;
+			auto [bad_ok, bad_error] = ::BusTrace::replay(trace, ram);
+			assert_true(!bad_ok, "inconsistent read");
+		}
+		
+		void file_format() {
+			namespace fs = std::filesystem;
+			auto path = get_temp_path("cpp_proc_bus_trace_test").string() + ".trace";
+			auto cmp = Machine(TimeTravel::make_fill_program());
+			auto trace = ::BusTrace::record(cmp, 300);
+			assert_equal(trace.Ticks, 300u, "tick limit");
+			auto [saved, save_error] = ::BusTrace::save(path, trace);
+			assert_true(saved, save_error);
+			auto payload = fs::file_size(path) - ::BusTrace::HEADER_SIZE - TimeTravel::RMS * WORD_BYTES;
+			assert_true(payload < trace.Transactions.size() * (3 + WORD_BYTES), "delta encoded");
+			
+			::BusTrace::Trace loaded;
+			auto [ok, error] = ::BusTrace::load(path, loaded);
+			assert_true(ok, error);
+			assert_equal(loaded.Ticks, trace.Ticks, "ticks");
+			assert_true(loaded.InitialRam == trace.InitialRam, "initial ram");
+			assert_true(loaded.Transactions == trace.Transactions, "transactions");
+			
+			{
+				auto f = std::fstream(path, std::ios::binary | std::ios::in | std::ios::out);
+				f.seekp(fs::file_size(path) - 1);
+				f.put(0x5A);
+			}
+			auto [corrupted_ok, corrupted_error] = ::BusTrace::load(path, loaded);
+			assert_true(!corrupted_ok, "checksum");
+			fs::remove(path);
+		}
+		
+		void divergence() {
+			auto program = TimeTravel::make_fill_program();
+			auto a = Machine(program);
+			auto trace_a = ::BusTrace::record(a);
+			auto same = Machine(program);
+			assert_true(!::BusTrace::find_divergence(trace_a, ::BusTrace::record(same)).Found, "same engine");
+			
+			program[0x07] = Word(0x90); // SET 0x90 0x02
+			auto b = Machine(program);
+			auto trace_b = ::BusTrace::record(b);
+			auto found = ::BusTrace::find_divergence(trace_a, trace_b);
+			assert_true(found.Found, "found");
+			auto patched = std::find_if(trace_a.Transactions.begin(), trace_a.Transactions.end(),
+				[](const ::BusTrace::Transaction& transaction) { return transaction.Address == 0x07; });
+			assert_equal(found.Tick, patched->Tick, "read of patched word");
+			
+			trace_b.Transactions = trace_a.Transactions;
+			trace_b.Transactions.pop_back();
+			auto shorter = ::BusTrace::find_divergence(trace_a, trace_b);
+			assert_true(shorter.Found, "missing transaction");
+			assert_equal(shorter.Tick, trace_a.Transactions.back().Tick, "missing transaction tick");
+		}
+		
+		void test() {
+			TestRunner tr("bus_trace");
+			tr.run_test(record_replay, "record_replay");
+			tr.run_test(file_format, "file_format");
+			tr.run_test(divergence, "divergence");
+		}
+	}
+	
+	namespace Breakpoints {
+		using Machine    = TimeTravel::Machine;
+		using Conditions = ::Breakpoints::Conditions;
+		using StopReason = ::Breakpoints::StopReason;
+		using namespace ::Logics::WordLayout;
+		
+		void breakpoint() {
+			auto cmp = Machine(TimeTravel::make_fill_program());
+			auto conditions = Conditions().at(0x09);
+			auto first = cmp.run_until(conditions);
+			assert_true(first.Reason == StopReason::Breakpoint, "first hit");
+			assert_equal(first.Ticks, 15u, "three SETs");
+			assert_equal(first.Location, 0x09u, "ip");
+			assert_equal(cmp.State.CPU.peek(IP), 0x09u, "stopped before fetch");
+			
+			auto second = cmp.run_until(conditions);
+			assert_true(second.Reason == StopReason::Breakpoint, "second hit");
+			assert_equal(cmp.State.CPU.peek(SERVICE_REGISTERS), 0x1Fu, "one loop iteration");
+			
+			auto limited = cmp.run_until(Conditions(conditions).after_ticks(7));
+			assert_true(limited.Reason == StopReason::TickLimit, "tick limit");
+			assert_equal(limited.Ticks, 7u, "ticks");
+			
+			auto done = cmp.run_until(Conditions());
+			assert_true(done.Reason == StopReason::Terminated, "terminated");
+			assert_true(cmp.State.CPU[cmp.Registers.Terminated].test(0), "terminated flag");
+		}
+		
+		void watchpoints() {
+			auto cmp = Machine(TimeTravel::make_fill_program());
+			auto written = cmp.run_until(Conditions().on_write(0x85));
+			assert_true(written.Reason == StopReason::Write, "write");
+			assert_equal(written.Location, 0x85u, "address");
+			assert_equal(cmp.State.RAM.peek(0x85), 0x1Bu, "value is written");
+			assert_equal(cmp.State.RAM.peek(0x86), 0u, "next is not written yet");
+			
+			auto reg = cmp.run_until(Conditions().when_register(SERVICE_REGISTERS, 0x10));
+			assert_true(reg.Reason == StopReason::Register, "register");
+			assert_equal(reg.Location, SERVICE_REGISTERS, "register index");
+			assert_equal(cmp.State.CPU.peek(SERVICE_REGISTERS), 0x10u, "register value");
+			
+			auto flag = cmp.run_until(Conditions().when_flags(ZF_BIT));
+			assert_true(flag.Reason == StopReason::Flag, "flag");
+			assert_equal(cmp.State.CPU.peek(SERVICE_REGISTERS), 0u, "counter is zero");
+			assert_equal(cmp.State.CPU.peek(IP), 0x13u, "set by CMP");
+		}
+		
+		// Same stop ticks as checking conditions after every Computer::tick,
+		// every write of the program changes a zero word, so a write is a change
+		void same_as_stepping() {
+			auto conditions = Conditions().on_write(0x90, 0x92).when_flags(ZF_BIT);
+			auto cmp = Machine(TimeTravel::make_fill_program());
+			auto reference = Machine(TimeTravel::make_fill_program());
+			for (size_t i = 0; i < 4; i++) {
+				auto stop = cmp.run_until(conditions);
+				uint64_t ticks = 0;
+				auto hit = false;
+				while (!hit) {
+					auto watched = reference.State.RAM.peek(0x90) + reference.State.RAM.peek(0x91) + reference.State.RAM.peek(0x92);
+					auto zero = reference.State.CPU.peek(FS) & ZF_BIT;
+					reference.tick();
+					ticks++;
+					hit = (watched != reference.State.RAM.peek(0x90) + reference.State.RAM.peek(0x91) + reference.State.RAM.peek(0x92)) ||
+						(!zero && (reference.State.CPU.peek(FS) & ZF_BIT));
+				}
+				assert_equal(stop.Ticks, ticks, "stop " + std::to_string(i));
+				assert_equal(cmp.State.CPU.get_all(), reference.State.CPU.get_all(), "state " + std::to_string(i));
+			}
+		}
+		
+		void test() {
+			TestRunner tr("breakpoints");
+			tr.run_test(breakpoint, "breakpoint");
+			tr.run_test(watchpoints, "watchpoints");
+			tr.run_test(same_as_stepping, "same_as_stepping");
+		}
+	}
+	
+	namespace LiveState {
+		using Frame  = ::LiveState::Frame;
+		using Sample = ::LiveState::Sample;
+		using Status = ::LiveState::Status;
+		
+		// Machine for the writer with every published word equal to the tick number
+		class Counting {
+		public:
+			static constexpr size_t CpuSize = 16;
+			
+			ComputerState<CpuSize, 1> State = { WordSet<1> { } };
+			
+			void set(uint64_t ticks) {
+				for (size_t i = 0; i < CpuSize; i++) {
+					State.CPU.poke(i, (i == ::Logics::WordLayout::FS) ? 0 : ticks);
+				}
+				State.ControlBus.poke(0, ticks);
+				State.AddressBus.poke(0, ticks);
+				State.DataBus.poke(0, ticks);
+			}
+		};
+		
+		void publish_read() {
+			auto cmp = TimeTravel::Machine(TimeTravel::make_fill_program());
+			cmp.tick(15);
+			Frame frame;
+			::LiveState::Writer(frame).publish(cmp, 15);
+			Sample sample;
+			assert_true(::LiveState::read(frame, sample), "read");
+			assert_equal(sample.Ticks, 15u, "ticks");
+			assert_true(sample.State == Status::Running, "running");
+			assert_equal(sample.CpuWords, TimeTravel::IMS, "cpu words");
+			for (size_t i = 0; i < TimeTravel::IMS; i++) {
+				assert_equal(size_t(sample.Cpu[i]), cmp.State.CPU.peek(i), "cpu word");
+			}
+			assert_equal(size_t(sample.Buses[1]), cmp.State.AddressBus.peek(0), "address bus");
+			
+			::LiveState::Writer(frame).publish(cmp, 15, true);
+			::LiveState::read(frame, sample);
+			assert_true(sample.State == Status::Stopped, "run ended before termination");
+			
+			while (cmp.tick()) { }
+			::LiveState::Writer(frame).publish(cmp, 1000, true);
+			::LiveState::read(frame, sample);
+			assert_true(sample.State == Status::Fatal, "RST sets Fatal flag too, as in CpuRunner");
+		}
+		
+		// Reader never sees words of different publications mixed
+		void concurrent() {
+			Frame frame;
+			const uint64_t publications = 100000;
+			atomic<bool> done = { false };
+			auto writer = thread([&]() {
+				Counting machine;
+				auto writer = ::LiveState::Writer(frame);
+				for (uint64_t ticks = 1; ticks <= publications; ticks++) {
+					machine.set(ticks);
+					writer.publish(machine, ticks);
+				}
+				done = true;
+			});
+			size_t torn = 0, samples = 0;
+			uint64_t last = 0;
+			Sample sample;
+			while (!done || (last < publications)) {
+				if (!::LiveState::read(frame, sample)) {
+					continue;
+				}
+				samples++;
+				auto word = uint32_t(sample.Ticks & WORD_MASK);
+				for (size_t i = 0; i < sample.CpuWords; i++) {
+					torn += ((i != ::Logics::WordLayout::FS) && (sample.Cpu[i] != word)) ? 1 : 0;
+				}
+				for (auto bus : sample.Buses) {
+					torn += (bus != word) ? 1 : 0;
+				}
+				assert_true(sample.Ticks >= last, "monotonic");
+				last = sample.Ticks;
+			}
+			writer.join();
+			assert_true(samples > 0, "samples");
+			assert_equal(torn, 0u, "torn reads");
+		}
+		
+		void shared_memory() {
+		#ifndef _WIN32
+			auto name = "/cpp_proc_live_state_test_" + std::to_string(::getpid());
+			auto cmp = TimeTravel::Machine(TimeTravel::make_fill_program());
+			cmp.tick(20);
+			::LiveState::SharedFrame published, monitor;
+			auto [created, create_error] = published.create(name);
+			assert_true(created, create_error);
+			::LiveState::Writer(*published.get()).publish(cmp, 20);
+			auto [opened, open_error] = monitor.open(name);
+			assert_true(opened, open_error);
+			Sample sample;
+			assert_true(::LiveState::read(*monitor.get(), sample), "read");
+			assert_equal(sample.Ticks, 20u, "ticks");
+			assert_equal(size_t(sample.Cpu[::Logics::WordLayout::IP]), cmp.State.CPU.peek(::Logics::WordLayout::IP), "ip");
+			
+			::LiveState::SharedFrame missing;
+			auto [missing_ok, missing_error] = missing.open(name + "_missing");
+			assert_true(!missing_ok, "missing segment");
+		#endif
+		}
+		
+		void test() {
+			TestRunner tr("live_state");
+			tr.run_test(publish_read, "publish_read");
+			tr.run_test(concurrent, "concurrent");
+			tr.run_test(shared_memory, "shared_memory");
+		}
+	}
+	
+	namespace MultiCore {
+		using ::Core::Arbitration;
+		
+		const size_t IMS   = MIN_MEMORY_SIZE + 3;
+		const size_t RMS   = 256;
+		const size_t CORES = 3;
+		
+		using Cores = ::Core::MultiComputer<IMS, RMS, CORES>;
+		
+		// 0x00: SET 0x08 0x00 => r[0] = 8
+		// 0x03: SET 0x00 0x01 => r[1] = 0
+		// 0x06: ST  0x00 0x02 => ram[r[2]] = r[0]
+		// 0x09: INC 0x02
+		// 0x0B: DEC 0x00
+		// 0x0D: CMP 0x00 0x01
+		// 0x10: JZ  0x14
+		// 0x12: JMP 0x06
+		// 0x14: RST
+		WordSet<RMS> make_program() {
+			return {
+				Word(Command::SET), Word(0x08), Word(0x00),
+				Word(Command::SET), Word(0x00), Word(0x01),
+				Word(Command::ST),  Word(0x00), Word(0x02),
+				Word(Command::INC), Word(0x02),
+				Word(Command::DEC), Word(0x00),
+				Word(Command::CMP), Word(0x00), Word(0x01),
+				Word(Command::JZ),  Word(0x14),
+				Word(Command::JMP), Word(0x06),
+				Word(Command::RST),
+			};
+		}
+		
+		// Core c stores 8..1 to ram[0x40 + 0x10 * c ...]
+		Cores make_cores(Arbitration policy, size_t ports = 1) {
+			auto cores = Cores(make_program(), policy, ports);
+			for (size_t c = 0; c < CORES; c++) {
+				cores.State[c].CPU.poke(SERVICE_REGISTERS + 2, NativeWord(0x40 + 0x10 * c));
+			}
+			return cores;
+		}
+		
+		void single_core() {
+			auto cmp = Computer<IMS, RMS>(TimeTravel::make_fill_program());
+			auto core = ::Core::MultiComputer<IMS, RMS, 1>(TimeTravel::make_fill_program());
+			auto running = true;
+			while (running) {
+				running = cmp.tick();
+				assert_equal(core.tick(), running, "running");
+				assert_equal(core.State[0].CPU.get_all(), cmp.State.CPU.get_all(), "cpu");
+				assert_equal(core.State[0].ControlBus.get_all(), cmp.State.ControlBus.get_all(), "control");
+			}
+			assert_equal(core.RAM.get_all(), cmp.State.RAM.get_all(), "ram");
+			assert_equal(core.get_stats().Contended, 0u, "no contention");
+			assert_equal(core.get_stats().PerCore[0].Stalls, 0u, "no stalls");
+		}
+		
+		void shared_ram() {
+			for (auto policy : { Arbitration::RoundRobin, Arbitration::Priority }) {
+				auto cores = make_cores(policy);
+				cores.run();
+				for (size_t c = 0; c < CORES; c++) {
+					assert_true(!cores.is_running(c), "terminated");
+					for (size_t k = 0; k < 8; k++) {
+						assert_equal(cores.RAM.peek(0x40 + 0x10 * c + k), 8 - k, "stored");
+					}
+				}
+				const auto& stats = cores.get_stats();
+				assert_true(stats.Contended > 0, "contention");
+				auto stalls = stats.PerCore[0].Stalls + stats.PerCore[1].Stalls + stats.PerCore[2].Stalls;
+				assert_true(stalls > 0, "stalls");
+				if (policy == Arbitration::Priority) {
+					assert_equal(stats.PerCore[0].Stalls, 0u, "highest priority never waits");
+				} else {
+					for (const auto& core : stats.PerCore) {
+						assert_true(core.MaxWait < CORES, "round robin wait is bounded");
+					}
+				}
+			}
+			auto wide = make_cores(Arbitration::RoundRobin, CORES);
+			wide.run();
+			assert_equal(wide.get_stats().Contended, 0u, "port per core");
+		}
+		
+		void threads() {
+			for (auto policy : { Arbitration::RoundRobin, Arbitration::Priority }) {
+				auto serial = make_cores(policy);
+				auto ticks = serial.run();
+				for (size_t threads = 2; threads <= CORES; threads++) {
+					auto parallel = make_cores(policy);
+					assert_equal(parallel.run(0, threads), ticks, "ticks");
+					assert_equal(parallel.RAM.get_all(), serial.RAM.get_all(), "ram");
+					for (size_t c = 0; c < CORES; c++) {
+						assert_equal(parallel.State[c].CPU.get_all(), serial.State[c].CPU.get_all(), "cpu");
+						assert_equal(parallel.get_stats().PerCore[c].Stalls, serial.get_stats().PerCore[c].Stalls, "stalls");
+					}
+				}
+			}
+			auto limited = make_cores(Arbitration::RoundRobin);
+			assert_equal(limited.run(10, 2), 10u, "tick limit");
+		}
+		
+		void test() {
+			TestRunner tr("multi_core");
+			tr.run_test(single_core, "single_core");
+			tr.run_test(shared_ram, "shared_ram");
+			tr.run_test(threads, "threads");
+		}
+	}
+	
+	namespace Dynamic {
+		using ::Core::DynamicComputer;
+		
+		const size_t WIDE_IMS = SERVICE_REGISTERS + 256;
+		const size_t WIDE_RMS = 256;
+		
+		template<size_t IMS, size_t RMS>
+		void compare(const Image<IMS, RMS>& image, size_t max_ticks) {
+			auto cmp = Computer<IMS, RMS>(image.Ram);
+			image.apply(cmp);
+			auto dynamic = DynamicComputer::from_image(image);
+			assert_equal(dynamic.cpu_size(), IMS, "cpu size");
+			assert_equal(dynamic.ram_size(), RMS, "ram size");
+			auto running = true;
+			for (size_t tick = 0; running && (tick < max_ticks); tick++) {
+				running = cmp.tick();
+				assert_equal(dynamic.tick(), running, "running");
+				for (size_t i = 0; i < IMS; i++) {
+					assert_equal(size_t(dynamic.cpu(i)), cmp.State.CPU.peek(i), "cpu");
+				}
+				assert_equal(size_t(dynamic.control()), cmp.State.ControlBus.peek(0), "control");
+				assert_equal(size_t(dynamic.address()), cmp.State.AddressBus.peek(0), "address");
+				assert_equal(size_t(dynamic.data()), cmp.State.DataBus.peek(0), "data");
+			}
+			for (size_t i = 0; i < RMS; i++) {
+				assert_equal(size_t(dynamic.ram(i)), cmp.State.RAM.peek(i), "ram");
+			}
+		}
+		
+		void same_as_computer() {
+			Image<TimeTravel::IMS, TimeTravel::RMS> fill;
+			fill.Ram = TimeTravel::make_fill_program();
+			compare(fill, 1000);
+			
+			// Stores out of the small RAM
+			Image<MultiCore::IMS, 32> outside;
+			std::copy_n(MultiCore::make_program().begin(), 32, outside.Ram.begin());
+			outside.Registers[SERVICE_REGISTERS + 2] = Word(0x1C);
+			compare(outside, 1000);
+			
+			std::mt19937 random(11);
+			auto code = std::uniform_int_distribution<int>(0, Command::SET);
+			auto value = std::uniform_int_distribution<int>(0, 255);
+			for (size_t i = 0; i < 8; i++) {
+				Image<WIDE_IMS, WIDE_RMS> image;
+				for (auto& word : image.Ram) {
+					word = Word(code(random));
+				}
+				for (size_t r = SERVICE_REGISTERS; r < WIDE_IMS; r++) {
+					image.Registers[r] = Word(value(random));
+				}
+				compare(image, 300);
+			}
+		}
+		
+		void invalid_register() {
+			// 0x00: SET 0x05 0x03 => r[3] = 5, only r[0] exists
+			vector<NativeWord> ram = { NativeWord(Command::SET), 0x05, 0x03 };
+			auto dynamic = DynamicComputer(MIN_MEMORY_SIZE + 1, ram);
+			auto thrown = false;
+			try {
+				dynamic.tick(10);
+			} catch (std::runtime_error* error) {
+				thrown = true;
+				delete error;
+			}
+			assert_true(thrown, "invalid register");
+			
+			dynamic.reset({ NativeWord(Command::RST) });
+			assert_equal(dynamic.ram_size(), 1u, "ram size");
+			assert_equal(size_t(dynamic.cpu(::Logics::WordLayout::IP)), 0u, "reset cpu");
+			while (dynamic.tick()) { }
+			assert_true(dynamic.is_fatal(), "rst is fatal");
+		}
+		
+		void test() {
+			TestRunner tr("dynamic");
+			tr.run_test(same_as_computer, "same_as_computer");
+			tr.run_test(invalid_register, "invalid_register");
+		}
+	}
+	
+	namespace Fleet {
+		using Job    = ::Fleet::Job<MIN_MEMORY_SIZE + 2, 16>;
+		using Result = ::Fleet::Result<MIN_MEMORY_SIZE + 2, 16>;
+		
+		Job make_job(size_t id, WordSet<16> ram) {
+			Job job;
+			job.Id = id;
+			job.Program.Ram = ram;
+			return job;
+		}
+		
+		void executor() {
+			// 0x00: SET 0x05 0x00 => r[0] = 5
+			// 0x03: SET 0x0F 0x01 => r[1] = 15
+			// 0x06: ST  0x00 0x01 => ram[r[1]] = r[0]
+			// 0x09: RST
+			auto store = make_job(0, {
+				Word(Command::SET), Word(0x05), Word(0x00),
+				Word(Command::SET), Word(0x0F), Word(0x01),
+				Word(Command::ST),  Word(0x00), Word(0x01),
+				Word(Command::RST),
+			});
+			// 0x00: JMP 0x00
+			auto loop = make_job(1, { Word(Command::JMP), Word(0x00) });
+			loop.MaxTicks = 100;
+			auto endless = make_job(2, { Word(Command::JMP), Word(0x00) });
+			endless.Timeout = std::chrono::milliseconds(2);
+			
+			vector<Job> jobs;
+			for (size_t i = 0; i < 10; i++) {
+				for (auto job : { store, loop, endless }) {
+					job.Id = jobs.size();
+					jobs.push_back(job);
+				}
+			}
+			auto executor = ::Fleet::Executor<MIN_MEMORY_SIZE + 2, 16>(3);
+			auto results = executor.run(jobs);
+			assert_equal(results.size(), jobs.size(), "results");
+			for (size_t i = 0; i < results.size(); i++) {
+				const auto& r = results[i];
+				assert_equal(r.Id, i, "order");
+				switch (i % 3) {
+					case 0:
+						assert_true(r.Status == ::Fleet::JobStatus::Fatal, "rst is fatal");
+						assert_equal(r.Ticks, 18u, "store ticks");
+						assert_equal(r.Ram[0x0F], Word(0x05), "stored");
+						break;
+					case 1:
+						assert_true(r.Status == ::Fleet::JobStatus::TickLimit, "tick limit");
+						assert_equal(r.Ticks, 100u, "budget");
+						break;
+					case 2:
+						assert_true(r.Status == ::Fleet::JobStatus::Deadline, "deadline");
+						assert_true(r.Ticks > 0, "progress");
+						break;
+				}
+			}
+		}
+		
+		void executor_invalid_program() {
+			// 0x00: INC 0x05 => only r[0] and r[1] exist, Computer throws
+			auto invalid = make_job(0, { Word(Command::INC), Word(0x05) });
+			// 0x00: INC 0x01, RST
+			auto valid = make_job(0, { Word(Command::INC), Word(0x01), Word(Command::RST) });
+			
+			vector<Job> jobs;
+			for (size_t i = 0; i < 6; i++) {
+				auto job = (i % 2 == 0) ? invalid : valid;
+				job.Id = i;
+				jobs.push_back(job);
+			}
+			auto executor = ::Fleet::Executor<MIN_MEMORY_SIZE + 2, 16>(2);
+			for (auto pass : { "first run", "second run" }) {
+				auto results = executor.run(jobs);
+				assert_equal(results.size(), jobs.size(), pass);
+				for (size_t i = 0; i < results.size(); i++) {
+					assert_equal(results[i].Id, i, "order");
+					auto expected = (i % 2 == 0) ? ::Fleet::JobStatus::Invalid : ::Fleet::JobStatus::Fatal;
+					assert_true(results[i].Status == expected, string(pass) + ": " + ::Fleet::to_string(results[i].Status));
+				}
+			}
+		}
+		
+		void result_cache() {
+			// 0x00: SET 0x05 0x00 => r[0] = 5
+			// 0x03: SET 0x0F 0x01 => r[1] = 15
+			// 0x06: ST  0x00 0x01 => ram[r[1]] = r[0]
+			// 0x09: RST
+			auto store = make_job(0, {
+				Word(Command::SET), Word(0x05), Word(0x00),
+				Word(Command::SET), Word(0x0F), Word(0x01),
+				Word(Command::ST),  Word(0x00), Word(0x01),
+				Word(Command::RST),
+			});
+			auto other = store;
+			other.Program.Ram[1] = Word(0x07);
+			auto endless = make_job(2, { Word(Command::JMP), Word(0x00) });
+			endless.Timeout = std::chrono::milliseconds(2);
+			
+			auto cache = ::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(1);
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 16>(WordSet<16>());
+			auto first = cache(cmp, store);
+			store.Id = 5;
+			auto second = cache(cmp, store);
+			assert_equal(second.Id, 5u, "id of the job");
+			assert_equal(second.Ticks, first.Ticks, "same ticks");
+			assert_equal(second.Ram[0x0F], Word(0x05), "stored");
+			auto metrics = cache.get_metrics();
+			assert_equal(metrics.Hits, 1u, "hit");
+			assert_equal(metrics.Misses, 1u, "miss");
+			
+			auto changed = cache(cmp, other);
+			assert_equal(changed.Ram[0x0F], Word(0x07), "other program");
+			assert_equal(cache.get_metrics().Evictions, 1u, "lru eviction");
+			Result found;
+			assert_true(!cache.find(store, found), "evicted");
+			
+			auto timed_out = cache(cmp, endless);
+			assert_true(timed_out.Status == ::Fleet::JobStatus::Deadline, "deadline");
+			assert_true(!cache.find(endless, found), "deadline is not cached");
+			
+			vector<Job> jobs(12, other);
+			auto executor = ::Fleet::Executor<MIN_MEMORY_SIZE + 2, 16>(3);
+			auto results = executor.run(jobs, cache);
+			for (const auto& r : results) {
+				assert_equal(r.Ram[0x0F], Word(0x07), "executor through cache");
+			}
+			assert_true(cache.get_metrics().Hits >= 3 + 9, "executor hits");
+		}
+		
+		void result_cache_disk() {
+			namespace fs = std::filesystem;
+			auto dir = get_temp_path("cpp_proc_result_cache_test");
+			fs::remove_all(dir);
+			auto make_counter = [](size_t n) {
+				// 0x00: SET n 0x00 => r[0] = n
+				// 0x03: RST
+				return make_job(n, { Word(Command::SET), Word(n), Word(0x00), Word(Command::RST) });
+			};
+			Result expected;
+			{
+				auto cache = ::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(4, dir.string());
+				auto cmp = Computer<MIN_MEMORY_SIZE + 2, 16>(WordSet<16>());
+				expected = cache(cmp, make_counter(1));
+				assert_equal(cache.get_metrics().DiskBytes, fs::file_size(*fs::directory_iterator(dir)), "disk bytes");
+			}
+			auto cache = ::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(4, dir.string());
+			Result found;
+			assert_true(cache.find(make_counter(1), found), "loaded from disk");
+			assert_equal(cache.get_metrics().DiskHits, 1u, "disk hit");
+			assert_equal(found.Ticks, expected.Ticks, "ticks");
+			assert_true(found.Cpu == expected.Cpu, "cpu");
+			assert_true(found.Ram == expected.Ram, "ram");
+			assert_true(cache.find(make_counter(1), found), "then in memory");
+			assert_equal(cache.get_metrics().Hits, 1u, "memory hit");
+			
+			// Header is covered by the checksum, status out of range is a corrupt entry even with a good checksum
+			auto path = fs::directory_iterator(dir)->path().string();
+			Snapshots::flip_byte(path, 40);
+			assert_true(!::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(4, dir.string()).find(make_counter(1), found), "header checksum");
+			Snapshots::flip_byte(path, 40);
+			{
+				auto f = std::fstream(path, std::ios::binary | std::ios::in | std::ios::out);
+				string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+				bytes[36] = 99;
+				auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+				auto checksum = Utils::hash_bytes(data, 48);
+				checksum = Utils::hash_bytes(data + ::Fleet::CacheFile::HEADER_SIZE, bytes.size() - ::Fleet::CacheFile::HEADER_SIZE, checksum);
+				f.seekp(36);
+				f.put(bytes[36]);
+				f.seekp(48);
+				::Images::write_le<uint64_t>(f, checksum);
+			}
+			assert_true(!::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(4, dir.string()).find(make_counter(1), found), "status range");
+			
+			auto file_size = cache.get_metrics().DiskBytes;
+			auto limited = ::Fleet::ResultCache<MIN_MEMORY_SIZE + 2, 16>(1, dir.string(), 3 * file_size);
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 16>(WordSet<16>());
+			for (size_t n = 2; n < 7; n++) {
+				limited(cmp, make_counter(n));
+			}
+			auto metrics = limited.get_metrics();
+			assert_true(metrics.DiskBytes <= 3 * file_size, "disk limit");
+			assert_equal(metrics.DiskEvictions, 3u, "disk evictions");
+			assert_true(limited.find(make_counter(6), found), "newest kept");
+			fs::remove_all(dir);
+		}
+		
+		void test() {
+			TestRunner tr("fleet");
+			tr.run_test(executor, "executor");
+			tr.run_test(executor_invalid_program, "executor_invalid_program");
+			tr.run_test(result_cache, "result_cache");
+			tr.run_test(result_cache_disk, "result_cache_disk");
+		}
+	}
+	
+	namespace Shards {
+		using Machine = Computer<MIN_MEMORY_SIZE + 2, 16>;
+		using Result  = ::Fleet::Result<MIN_MEMORY_SIZE + 2, 16>;
+		using Executor = ::Fleet::Executor<MIN_MEMORY_SIZE + 2, 16>;
+		
+		const size_t JOBS = 10;
+		
+		// Directory with image ram[r[1]] = r[0], RST and manifest of JOBS jobs storing job index,
+		// the last one has too few ticks to store
+		std::filesystem::path make_run(const string& name) {
+			namespace fs = std::filesystem;
+			auto dir = get_temp_path(name);
+			fs::remove_all(dir);
+			fs::create_directories(dir / "images");
+			{
+				// 0x00: ST  0x00 0x01 => ram[r[1]] = r[0]
+				// 0x03: RST
+				auto f = std::ofstream(dir / "images" / "store.txt");
+				for (auto word : { Word(Command::ST), Word(0x00), Word(0x01), Word(Command::RST) }) {
+					f << word << "\n";
+				}
+			}
+			auto f = std::ofstream(dir / "jobs.txt");
+			f << "# stores job index to ram[15]\n";
+			for (size_t i = 0; i < JOBS; i++) {
+				f << "images/store.txt r0=" << i << " r1=0x0F" << ((i + 1 == JOBS) ? " ticks=3" : "") << "\n";
+			}
+			return dir;
+		}
+		
+		string read_file(const string& path) {
+			auto f = std::ifstream(path, std::ios::binary);
+			return string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		}
+		
+		void manifest() {
+			::Shards::Entry entry;
+			auto [ok, error] = ::Shards::parse_entry("a/b.img ticks=100 ip=0x10 r2=7", entry);
+			assert_true(ok, error);
+			assert_equal(entry.Path, string("a/b.img"), "path");
+			assert_equal(entry.MaxTicks, 100u, "ticks");
+			assert_equal(entry.EntryIP, 16u, "ip");
+			assert_equal(entry.Registers.size(), 1u, "override");
+			assert_equal(entry.Registers[0].Index, SERVICE_REGISTERS + 2, "register index");
+			assert_equal(entry.Registers[0].Value, 7u, "register value");
+			auto [bad_key, bad_key_error] = ::Shards::parse_entry("a.img speed=1", entry);
+			assert_true(!bad_key, "unknown key");
+			auto [bad_value, bad_value_error] = ::Shards::parse_entry("a.img ticks=x", entry);
+			assert_true(!bad_value, "bad number");
+			
+			::Shards::Shard shard;
+			assert_true(::Shards::parse_shard("2/3", shard), "shard");
+			assert_true(shard.owns(5) && !shard.owns(4), "owns");
+			assert_true(!::Shards::parse_shard("3/3", shard), "index out of count");
+			
+			auto dir = make_run("cpp_proc_manifest_test");
+			::Shards::Manifest first, second;
+			auto [loaded, load_error] = ::Shards::load_manifest((dir / "jobs.txt").string(), first);
+			assert_true(loaded, load_error);
+			assert_equal(first.Jobs.size(), JOBS, "jobs");
+			assert_equal(first.Jobs[0].ResolvedPath, (dir / "images/store.txt").string(), "resolved path");
+			std::ofstream(dir / "jobs.txt", std::ios::app) << "images/store.txt\n";
+			::Shards::load_manifest((dir / "jobs.txt").string(), second);
+			assert_true(first.Hash != second.Hash, "hash of jobs");
+			std::filesystem::remove_all(dir);
+		}
+		
+		void run_and_merge() {
+			auto dir = make_run("cpp_proc_shards_test");
+			::Shards::Manifest manifest;
+			::Shards::load_manifest((dir / "jobs.txt").string(), manifest);
+			auto executor = Executor(2);
+			vector<string> shards;
+			for (size_t k = 0; k < 3; k++) {
+				shards.push_back((dir / ("shard" + std::to_string(k) + ".results")).string());
+				::Shards::ShardReport report;
+				auto [ok, error] = ::Shards::run_shard(manifest, { k, 3 }, shards.back(), 0, executor, report);
+				assert_true(ok, error);
+				assert_equal(report.Owned, (JOBS + 2 - k) / 3, "owned");
+				assert_equal(report.Done, report.Owned, "done");
+			}
+			
+			::Shards::MergeReport report;
+			auto merged = (dir / "merged.results").string();
+			auto [ok, error] = ::Shards::merge(shards, merged, report);
+			assert_true(ok, error);
+			assert_equal(report.Found, JOBS, "found");
+			::Shards::ResultFile<MIN_MEMORY_SIZE + 2, 16> results;
+			auto [opened, open_error] = results.open(merged);
+			assert_true(opened, open_error);
+			assert_equal(results.size(), JOBS, "indexed");
+			Result result;
+			for (size_t i = 0; i + 1 < JOBS; i++) {
+				assert_true(results.get(i, result), "result");
+				assert_true(result.Status == ::Fleet::JobStatus::Fatal, "rst is fatal");
+				assert_equal(result.Ram[0x0F], Word(i), "stored index");
+			}
+			assert_true(results.get(JOBS - 1, result), "last result");
+			assert_true(result.Status == ::Fleet::JobStatus::TickLimit, "tick budget");
+			
+			::Shards::ShardReport other;
+			auto [other_ok, other_error] = ::Shards::run_shard(manifest, { 0, 2 }, shards[0], 0, executor, other);
+			assert_true(!other_ok, "another shard");
+			
+			// Shard merged alone is incomplete, deterministic run gives the same merged file
+			auto [partial_ok, partial_error] = ::Shards::merge({ shards[1] }, merged, report);
+			assert_true(partial_ok, partial_error);
+			assert_true(report.Found < JOBS, "missing jobs");
+			auto again = (dir / "again.results").string();
+			::Shards::merge(shards, merged, report);
+			std::filesystem::rename(shards[0], shards[0] + ".old");
+			::Shards::ShardReport rerun;
+			::Shards::run_shard(manifest, { 0, 3 }, shards[0], 0, executor, rerun);
+			::Shards::merge(shards, again, report);
+			assert_true(read_file(merged) == read_file(again), "deterministic");
+			std::filesystem::remove_all(dir);
+		}
+		
+		void resume() {
+			auto dir = make_run("cpp_proc_shards_resume_test");
+			::Shards::Manifest manifest;
+			::Shards::load_manifest((dir / "jobs.txt").string(), manifest);
+			auto executor = Executor(1);
+			auto path = (dir / "shard.results").string();
+			::Shards::ShardReport report;
+			::Shards::run_shard(manifest, { 0, 1 }, path, 0, executor, report);
+			
+			// Interrupted while writing the fourth record
+			auto record_size = ::Shards::get_record_size(MIN_MEMORY_SIZE + 2, 16);
+			std::filesystem::resize_file(path, ::Shards::HEADER_SIZE + 3 * record_size + 5);
+			auto [ok, error] = ::Shards::run_shard(manifest, { 0, 1 }, path, 0, executor, report);
+			assert_true(ok, error);
+			assert_equal(report.Resumed, 3u, "resumed");
+			assert_equal(report.Done, JOBS - 3, "rest");
+			assert_equal(std::filesystem::file_size(path), ::Shards::HEADER_SIZE + JOBS * record_size, "no partial record");
+			
+			::Shards::MergeReport merged;
+			::Shards::merge({ path }, (dir / "merged.results").string(), merged);
+			assert_equal(merged.Found, JOBS, "all jobs");
+			assert_equal(merged.Corrupted, 0u, "no corrupted");
+			std::filesystem::remove_all(dir);
+		}
+		
+		void test() {
+			TestRunner tr("shards");
+			tr.run_test(manifest, "manifest");
+			tr.run_test(run_and_merge, "run_and_merge");
+			tr.run_test(resume, "resume");
+		}
+	}
+	
+	namespace Events {
+		using ::Events::Kind;
+		using ::Events::Event;
+		
+		// 0x00: SET 0x05 0x00 => r[0] = 5
+		// 0x03: SET 0x0F 0x01 => r[1] = 15
+		// 0x06: ST  0x00 0x01 => ram[r[1]] = r[0]
+		// 0x09: RST
+		WordSet<16> make_store() {
+			return {
+				Word(Command::SET), Word(0x05), Word(0x00),
+				Word(Command::SET), Word(0x0F), Word(0x01),
+				Word(Command::ST),  Word(0x00), Word(0x01),
+				Word(Command::RST),
+			};
+		}
+		
+		void all_events() {
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 16>(make_store());
+			vector<Event> events;
+			for (const auto& event : cmp.run()) {
+				events.push_back(event);
+			}
+			vector<Event> retired;
+			std::copy_if(events.begin(), events.end(), std::back_inserter(retired), [](const auto& e) { return e.Type == Kind::Retired; });
+			assert_equal(retired.size(), 4u, "retired");
+			assert_equal(retired[2].IP, 6u, "st ip");
+			assert_equal(size_t(retired[2].Code), size_t(Command::ST), "st code");
+			assert_equal(size_t(retired[2].Y), 1u, "st y");
+			assert_equal(size_t(retired[3].Code), size_t(Command::RST), "rst code");
+			
+			auto write = std::find_if(events.begin(), events.end(), [](const auto& e) { return e.Type == Kind::RamWrite; });
+			assert_true(write != events.end(), "ram write");
+			assert_equal(write->Address, 0x0Fu, "write address");
+			assert_equal(size_t(write->Value), 5u, "write value");
+			assert_true(write->Tick > retired[2].Tick, "write after st");
+			
+			auto flags = std::find_if(events.begin(), events.end(), [](const auto& e) { return e.Type == Kind::FlagChange; });
+			assert_true(flags != events.end(), "flag change");
+			assert_equal(size_t(flags->NewFlags & ::Logics::WordLayout::TR_BIT), 1u, "terminated flag");
+			
+			assert_true(events.back().Type == Kind::Terminated, "terminated is last");
+			assert_true(events.back().Fatal, "rst is fatal");
+			assert_equal(events.back().Tick, 18u, "ticks");
+		}
+		
+		void filtered() {
+			auto cmp = Computer<MIN_MEMORY_SIZE + 2, 16>(make_store());
+			auto stream = cmp.run<::Events::mask(Kind::RamWrite)>();
+			Event event;
+			assert_true(stream.next(event), "has write");
+			assert_true(event.Type == Kind::RamWrite, "only writes");
+			assert_true(!stream.next(event), "single write");
+			assert_true(stream.is_done(), "done");
+			assert_equal(stream.get_ticks(), 18u, "ran to termination");
+			
+			auto limited = Computer<MIN_MEMORY_SIZE + 2, 16>(make_store());
+			size_t count = 0;
+			for (const auto& e : limited.run<::Events::mask(Kind::Retired)>(10)) {
+				count += (e.Type == Kind::Retired) ? 1 : 0;
+			}
+			assert_equal(count, 2u, "tick limit"); // SET takes 5 ticks
+		}
+		
+		void interleaved() {
+			// Machines are pulled in turn on one thread, each one keeps its own progress
+			using Machine = Computer<MIN_MEMORY_SIZE + 2, 16, InstructionCounter>;
+			using Stream = ::Events::Stream<Machine, ::Events::mask(Kind::Retired)>;
+			vector<std::unique_ptr<Machine>> machines;
+			vector<Stream> streams;
+			for (size_t i = 0; i < 3; i++) {
+				auto ram = make_store();
+				ram[1] = Word(i + 1);
+				machines.push_back(std::make_unique<Machine>(ram));
+			}
+			for (auto& machine : machines) {
+				streams.emplace_back(*machine);
+			}
+			vector<size_t> retired(streams.size(), 0);
+			auto active = true;
+			while (active) {
+				active = false;
+				for (size_t i = 0; i < streams.size(); i++) {
+					Event event;
+					if (streams[i].next(event)) {
+						retired[i]++;
+						active = true;
+					}
+				}
+			}
+			for (size_t i = 0; i < machines.size(); i++) {
+				assert_equal(retired[i], machines[i]->get_probe().Executed, "same as counter");
+				assert_equal(machines[i]->State.RAM[WReference(0x0F * WORD_SIZE)], Word(i + 1), "stored");
+			}
+		}
+		
+		void test() {
+			TestRunner tr("events");
+			tr.run_test(all_events, "all_events");
+			tr.run_test(filtered, "filtered");
+			tr.run_test(interleaved, "interleaved");
+		}
+	}
+	
+	namespace Batch {
+		using ::Batch::LaneStatus;
+		using ::Batch::BatchComputer;
+		
+		const size_t WIDE_IMS = SERVICE_REGISTERS + 256; // every word is a valid register index
+		const size_t WIDE_RMS = 256;                     // every word is a valid address
+		
+		// Runs every image on own Computer and all of them on one BatchComputer, states must match
+		template<size_t IMS, size_t RMS>
+		void compare(const vector<Image<IMS, RMS>>& images, size_t max_ticks, bool vectorized, BatchComputer<IMS, RMS>& batch) {
+			for (size_t i = 0; i < images.size(); i++) {
+				batch.load(i, images[i]);
+			}
+			batch.set_vectorized(vectorized);
+			batch.run(max_ticks);
+			for (size_t i = 0; i < images.size(); i++) {
+				auto cmp = Computer<IMS, RMS>(images[i].Ram);
+				images[i].apply(cmp);
+				size_t ticks = 0;
+				auto running = true;
+				while (running && (ticks < max_ticks)) {
+					running = cmp.tick();
+					ticks++;
+				}
+				auto lane = "lane " + std::to_string(i);
+				assert_equal(batch.get_ticks(i), ticks, lane + " ticks");
+				auto fatal = cmp.State.CPU[cmp.Registers.Fatal].test(0);
+				auto status = running ? LaneStatus::Running : (fatal ? LaneStatus::Fatal : LaneStatus::Terminated);
+				assert_true(batch.get_status(i) == status, lane + " status");
+				for (size_t r = 0; r < IMS; r++) {
+					assert_equal(Word(batch.get_cpu(i, r)), cmp.State.CPU[cmp.Registers.get_register(r)], lane + " register " + std::to_string(r));
+				}
+				for (size_t a = 0; a < RMS; a++) {
+					assert_equal(Word(batch.get_ram(i, a)), cmp.State.RAM[WReference(a * WORD_SIZE)], lane + " ram " + std::to_string(a));
+				}
+				assert_equal(Word(batch.get_control(i)), cmp.State.ControlBus[WReference(0)], lane + " control");
+				assert_equal(Word(batch.get_address(i)), cmp.State.AddressBus[WReference(0)], lane + " address");
+				assert_equal(Word(batch.get_data(i)), cmp.State.DataBus[WReference(0)], lane + " data");
+			}
+		}
+		
+		void same_as_computer() {
+			// Random programs of known commands with random registers, any word is a valid
+			// command, register index and address, so every program is well defined
+			using WideImage = Image<WIDE_IMS, WIDE_RMS>;
+			std::mt19937 random(42);
+			auto code = std::uniform_int_distribution<int>(0, Command::SET);
+			auto value = std::uniform_int_distribution<int>(0, 255);
+			vector<WideImage> images(40);
+			for (size_t i = 0; i < images.size(); i++) {
+				auto& image = images[i];
+				for (auto& word : image.Ram) {
+					auto c = code(random);
+					// Even programs have no RST, so they mostly run to the tick limit
+					word = Word(((i % 2 == 0) && (c == Command::RST)) ? int(Command::JZ) : c);
+				}
+				for (size_t r = SERVICE_REGISTERS; r < WIDE_IMS; r++) {
+					image.Registers[r] = Word(value(random));
+				}
+			}
+			// Half of lanes share one program and differ in registers only
+			for (size_t i = 1; i < images.size() / 2; i++) {
+				images[i].Ram = images[0].Ram;
+			}
+			for (auto vectorized : { true, false }) {
+				BatchComputer<WIDE_IMS, WIDE_RMS> batch(images.size());
+				compare(images, 300, vectorized, batch);
+			}
+		}
+		
+		void divergence() {
+			// 0x00: LD  0x02 0x00 => r[0] = ram[r[2]] (r[2] = 0x10)
+			// 0x03: SET 0x00 0x01 => r[1] = 0
+			// 0x06: DEC 0x00
+			// 0x08: CMP 0x00 0x01
+			// 0x0B: JZ  0x0F
+			// 0x0D: JMP 0x06
+			// 0x0F: RST
+			// 0x10: count
+			using SmallImage = Image<MIN_MEMORY_SIZE + 3, 32>;
+			vector<SmallImage> images(37);
+			for (size_t i = 0; i < images.size(); i++) {
+				auto& image = images[i];
+				image.Ram = {
+					Word(Command::LD),  Word(0x02), Word(0x00),
+					Word(Command::SET), Word(0x00), Word(0x01),
+					Word(Command::DEC), Word(0x00),
+					Word(Command::CMP), Word(0x00), Word(0x01),
+					Word(Command::JZ),  Word(0x0F),
+					Word(Command::JMP), Word(0x06),
+					Word(Command::RST),
+					Word(1 + i % 5),
+				};
+				image.Registers[SERVICE_REGISTERS + 2] = Word(0x10);
+			}
+			// Lane 0 reads out of RAM and stores there
+			images[0].Registers[SERVICE_REGISTERS + 2] = Word(0xF0);
+			images[0].Ram[0] = Word(Command::ST);
+			
+			BatchComputer<MIN_MEMORY_SIZE + 3, 32> batch(images.size());
+			compare(images, 1000, true, batch);
+			assert_true(batch.get_divergent_ticks() > 0, "lanes diverged");
+			assert_true(batch.get_ticks(1) != batch.get_ticks(2), "lanes finished at different ticks");
+		}
+		
+		void invalid_register() {
+			// 0x00: INC 0x05 => only r[0] exists
+			Image<MIN_MEMORY_SIZE + 1, 4> image;
+			image.Ram = { Word(Command::INC), Word(0x05) };
+			for (auto vectorized : { true, false }) {
+				BatchComputer<MIN_MEMORY_SIZE + 1, 4> batch(1);
+				batch.load(0, image);
+				batch.set_vectorized(vectorized);
+				assert_equal(batch.run(), 4u, "stops at execute");
+				assert_true(batch.get_status(0) == LaneStatus::Invalid, "invalid");
+			}
+		}
+		
+		void test() {
+			TestRunner tr("batch");
+			tr.run_test(same_as_computer, "same_as_computer");
+			tr.run_test(divergence, "divergence");
+			tr.run_test(invalid_register, "invalid_register");
+		}
+	}
+	
 	namespace Cases {
 		void array_sum() {
 			// TODO: Re-implement
@@ -799,7 +2585,9 @@ namespace Tests {
 		}
 	}
 	
-	void test_all() {
+	// Tests of all groups run together on threads (0 - hardware threads), logs: with all logs
+	void test_all(size_t threads = 0, bool logs = false) {
+		TestUtils::TestSession session(threads, logs);
 		Tests::Common::test();
 		Tests::Bits::test();
 		Tests::Core::test();
@@ -807,6 +2595,20 @@ namespace Tests {
 		Tests::Architecture::test();
 		Tests::Logics::test();
 		Tests::Commands::test();
+		Tests::Instrumentation::test();
+		Tests::Events::test();
+		Tests::Images::test();
+		Tests::Snapshots::test();
+		Tests::TimeTravel::test();
+		Tests::BusTrace::test();
+		Tests::Breakpoints::test();
+		Tests::LiveState::test();
+		Tests::MultiCore::test();
+		Tests::Dynamic::test();
+		Tests::Fleet::test();
+		Tests::Shards::test();
+		Tests::Batch::test();
 		Tests::Cases::test();
+		session.run();
 	}
 }
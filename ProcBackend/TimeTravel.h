@@ -0,0 +1,294 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "Computer.h"
+#include "WordRunner.h"
+#include "Architecture.h"
+
+using std::array;
+using std::deque;
+using std::tuple;
+using std::string;
+using std::vector;
+
+using Core::Computer;
+using Architecture::WordSet;
+using Architecture::NativeWord;
+
+namespace TimeTravel {
+	// Memory bounds of a timeline, oldest ticks are forgotten when either limit is reached
+	class Limits {
+	public:
+		size_t MaxTicks           = 1 << 16; // journaled ticks
+		size_t MaxDeltas          = 1 << 18; // changed words of all journaled ticks
+		size_t CheckpointInterval = 1024;    // ticks between checkpoints, 0 - no checkpoints
+	};
+
+	// Changed word: CPU word, then control, address and data bus, then RAM words
+	class Delta {
+	public:
+		uint32_t   Location = 0;
+		NativeWord Old      = 0;
+		NativeWord New      = 0;
+	};
+
+	// Computer with recorded history: every tick is journaled as words it changed
+	// (old and new values, ring of fixed capacity), and every CheckpointInterval ticks
+	// a copy-on-write snapshot is kept. seek() moves from the current state or from
+	// the nearest checkpoint, whichever is closer, applying journaled deltas,
+	// so its cost is proportional to that distance, not to the tick number.
+	// Ticks after the newest journaled one are executed.
+	template<size_t IMS, size_t RMS>
+	class Timeline {
+		using Machine  = Computer<IMS, RMS>;
+		using Snapshot = typename Machine::Snapshot;
+
+		static const size_t BUSES = 3;
+		static const size_t RAM   = IMS + BUSES; // location of RAM word 0
+		static const size_t MAX_TICK_DELTAS = IMS + BUSES + 1;
+
+		class Record {
+		public:
+			uint64_t First   = 0; // sequence number of the first delta
+			uint32_t Count   = 0;
+			bool     Running = true; // result of Computer::tick
+		};
+
+		class Checkpoint {
+		public:
+			uint64_t Tick;
+			Snapshot State;
+		};
+
+	public:
+		Timeline(WordSet<RMS> init_ram, Limits limits = Limits()):
+			_machine(init_ram),
+			_limits(limits),
+			_deltas(std::max(limits.MaxDeltas, MAX_TICK_DELTAS)),
+			_records(std::max<size_t>(limits.MaxTicks, 1)) {
+			add_checkpoint();
+		}
+
+		const Machine& get_computer() const {
+			return _machine;
+		}
+
+		uint64_t get_tick() const {
+			return _tick;
+		}
+
+		// Oldest reachable tick
+		uint64_t get_first_tick() const {
+			return _last - _record_count;
+		}
+
+		// Newest journaled tick, later ticks are executed by seek() and tick()
+		uint64_t get_last_tick() const {
+			return _last;
+		}
+
+		size_t get_delta_count() const {
+			return _delta_count;
+		}
+
+		size_t get_checkpoint_count() const {
+			return _checkpoints.size();
+		}
+
+		// Same as Computer::tick, journaled ticks are replayed from the journal
+		bool tick() {
+			if (_tick < _last) {
+				const auto& record = get_record(_tick + 1);
+				redo(record);
+				_tick++;
+				return record.Running;
+			}
+			return execute();
+		}
+
+		// Ticks after the newest journaled one are executed until the machine stops,
+		// a seek past that fails and leaves the machine at the last tick it reached (see get_tick)
+		tuple<bool, string> seek(uint64_t tick) {
+			if (tick < get_first_tick()) {
+				return { false, "tick " + std::to_string(tick) + " is forgotten, first is " + std::to_string(get_first_tick()) };
+			}
+			auto target = std::min(tick, _last);
+			auto nearest = find_checkpoint(target);
+			if ((nearest != nullptr) && (distance(nearest->Tick, target) < distance(_tick, target))) {
+				_machine.restore(nearest->State);
+				_tick = nearest->Tick;
+			}
+			for (; _tick > target; _tick--) {
+				undo(get_record(_tick));
+			}
+			for (; _tick < target; _tick++) {
+				redo(get_record(_tick + 1));
+			}
+			auto running = (_last == 0) || get_record(_last).Running;
+			while (running && (_tick < tick)) {
+				running = execute();
+			}
+			if (_tick < tick) {
+				return { false, "machine stopped at tick " + std::to_string(_tick) + ", before tick " + std::to_string(tick) };
+			}
+			return { true, "" };
+		}
+
+		tuple<bool, string> step_back(uint64_t ticks = 1) {
+			if (ticks > _tick) {
+				return { false, "can't step before tick 0" };
+			}
+			return seek(_tick - ticks);
+		}
+
+	private:
+		Machine            _machine;
+		const Limits       _limits;
+		vector<Delta>      _deltas;  // ring arena, delta with sequence number s is at s % size
+		vector<Record>     _records; // ring, record of tick t is at t % size
+		deque<Checkpoint>  _checkpoints;
+		uint64_t           _next_delta   = 0; // sequence number of the next delta
+		size_t             _delta_count  = 0;
+		size_t             _record_count = 0;
+		uint64_t           _tick         = 0; // state of the machine
+		uint64_t           _last         = 0;
+		array<NativeWord, RAM> _before   = { };
+
+		static uint64_t distance(uint64_t a, uint64_t b) {
+			return (a > b) ? (a - b) : (b - a);
+		}
+
+		const Record& get_record(uint64_t tick) const {
+			return _records[tick % _records.size()];
+		}
+
+		const Delta& get_delta(uint64_t sequence) const {
+			return _deltas[sequence % _deltas.size()];
+		}
+
+		// Checkpoint nearest to the target, earlier or later
+		const Checkpoint* find_checkpoint(uint64_t target) const {
+			auto later = std::lower_bound(_checkpoints.begin(), _checkpoints.end(), target,
+				[](const Checkpoint& checkpoint, uint64_t tick) { return checkpoint.Tick < tick; });
+			const Checkpoint* nearest = nullptr;
+			if (later != _checkpoints.end()) {
+				nearest = &*later;
+			}
+			if (later != _checkpoints.begin()) {
+				auto earlier = &*std::prev(later);
+				if ((nearest == nullptr) || (distance(earlier->Tick, target) < distance(nearest->Tick, target))) {
+					nearest = earlier;
+				}
+			}
+			return nearest;
+		}
+
+		void set_word(uint32_t location, NativeWord value) {
+			auto& state = _machine.State;
+			if (location < IMS) {
+				state.CPU.poke(location, value);
+			} else if (location == IMS) {
+				state.ControlBus.poke(0, value);
+			} else if (location == IMS + 1) {
+				state.AddressBus.poke(0, value);
+			} else if (location == IMS + 2) {
+				state.DataBus.poke(0, value);
+			} else {
+				state.RAM.poke(location - RAM, value);
+			}
+		}
+
+		void undo(const Record& record) {
+			for (auto i = record.First + record.Count; i > record.First; i--) {
+				const auto& delta = get_delta(i - 1);
+				set_word(delta.Location, delta.Old);
+			}
+		}
+
+		void redo(const Record& record) {
+			for (auto i = record.First; i < record.First + record.Count; i++) {
+				const auto& delta = get_delta(i);
+				set_word(delta.Location, delta.New);
+			}
+		}
+
+		void read_words(array<NativeWord, RAM>& words) const {
+			const auto& state = _machine.State;
+			for (size_t i = 0; i < IMS; i++) {
+				words[i] = NativeWord(state.CPU.peek(i));
+			}
+			words[IMS]     = NativeWord(state.ControlBus.peek(0));
+			words[IMS + 1] = NativeWord(state.AddressBus.peek(0));
+			words[IMS + 2] = NativeWord(state.DataBus.peek(0));
+		}
+
+		bool execute() {
+			using namespace Logics::WordLayout;
+			read_words(_before);
+			// RAM is changed only by a write requested on the bus by the previous tick
+			auto control = _before[IMS];
+			size_t address = _before[IMS + 1];
+			auto write = ((control & (BUS_ENABLED | BUS_WRITE)) == (BUS_ENABLED | BUS_WRITE)) && (address < RMS);
+			auto old_ram = write ? NativeWord(_machine.State.RAM.peek(address)) : NativeWord(0);
+
+			auto running = _machine.tick();
+
+			array<NativeWord, RAM> after;
+			read_words(after);
+			forget(MAX_TICK_DELTAS);
+			Record record;
+			record.First   = _next_delta;
+			record.Running = running;
+			auto push = [&](size_t location, NativeWord old_value, NativeWord new_value) {
+				auto& delta = _deltas[_next_delta % _deltas.size()];
+				delta.Location = uint32_t(location);
+				delta.Old      = old_value;
+				delta.New      = new_value;
+				_next_delta++;
+				record.Count++;
+			};
+			for (size_t i = 0; i < RAM; i++) {
+				if (_before[i] != after[i]) {
+					push(i, _before[i], after[i]);
+				}
+			}
+			if (write) {
+				auto new_ram = NativeWord(_machine.State.RAM.peek(address));
+				if (new_ram != old_ram) {
+					push(RAM + address, old_ram, new_ram);
+				}
+			}
+			_delta_count += record.Count;
+			_tick++;
+			_last = _tick;
+			_records[_tick % _records.size()] = record;
+			_record_count++;
+			if ((_limits.CheckpointInterval > 0) && (_tick % _limits.CheckpointInterval == 0)) {
+				add_checkpoint();
+			}
+			return running;
+		}
+
+		void add_checkpoint() {
+			_checkpoints.push_back({ _tick, _machine.snapshot() });
+		}
+
+		// Drops oldest ticks until a new tick with given deltas fits into limits
+		void forget(size_t deltas) {
+			while ((_record_count > 0) && ((_record_count == _records.size()) || (_delta_count + deltas > _deltas.size()))) {
+				_delta_count -= get_record(get_first_tick() + 1).Count;
+				_record_count--;
+			}
+			while (!_checkpoints.empty() && (_checkpoints.front().Tick < get_first_tick())) {
+				_checkpoints.pop_front();
+			}
+		}
+	};
+}
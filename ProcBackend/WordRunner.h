@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CpuRunner.h"
+#include "CpuCommands.h"
+#include "Architecture.h"
+
+using Logics::Tick;
+using Logics::Command;
+using Architecture::NativeWord;
+using Architecture::WORD_MASK;
+using Architecture::WORD_SIZE;
+using Architecture::SERVICE_REGISTERS;
+
+namespace Logics {
+	// Register layout and flag bits of RegisterSet as plain word indexes
+	namespace WordLayout {
+		const size_t SS = 0;
+		const size_t CC = 1;
+		const size_t A1 = 2;
+		const size_t A2 = 3;
+		const size_t FS = 4;
+		const size_t CR = 5;
+		const size_t IP = 6;
+		const size_t AR = 7;
+
+		const NativeWord PS_MASK = 0b0111; // SS: pipeline state
+		const NativeWord AM_BIT  = 0b1000; // SS: argument mode
+		const NativeWord TR_BIT  = 0b0001; // FS: terminated
+		const NativeWord OF_BIT  = 0b0010; // FS: overflow
+		const NativeWord FT_BIT  = 0b0100; // FS: fatal
+		const NativeWord ZF_BIT  = 0b1000; // FS: zero
+
+		const NativeWord BUS_ENABLED = 0b01; // control bus: ram access requested
+		const NativeWord BUS_WRITE   = 0b10; // control bus: write, not read
+
+		// Arguments count of every command, -1 - unknown command (same as CpuCommands handlers)
+		const int COMMAND_ARGS[] = {
+			0, 0, 1, 1, 2, 2, 0, 0, 1, 2, 2, 2, 1, 1, 0, 1, 1, 1, 2, 1, 2,
+		};
+		const size_t COMMAND_COUNT = sizeof(COMMAND_ARGS) / sizeof(COMMAND_ARGS[0]);
+
+		int get_arguments(NativeWord code) {
+			return (code < COMMAND_COUNT) ? COMMAND_ARGS[code] : -1;
+		}
+	}
+
+	enum class WordTick {
+		Running, // tick returned true
+		Stopped, // tick returned false (Terminated flag is set)
+		Invalid, // command used common register out of range (Computer throws here)
+	};
+
+	// Word-level model of Computer::tick (RamRunner, CpuRunner and CpuCommands together),
+	// used by engines which keep machine state as plain integers.
+	// Lane provides access to one machine:
+	//   NativeWord& cpu(size_t index), NativeWord& ram(size_t address),
+	//   NativeWord& control(), NativeWord& address(), NativeWord& data(),
+	//   size_t cpu_size(), size_t ram_size()
+	// Out of range RAM addresses behave like in RamRunner: reads give zero, writes are ignored.
+	template<class Lane>
+	class WordRunner {
+	public:
+		WordRunner(Lane& lane): _lane(lane) { }
+
+		WordTick tick() {
+			tick_ram();
+			return tick_cpu();
+		}
+
+		void tick_ram() {
+			auto control = _lane.control();
+			if ((control & WordLayout::BUS_ENABLED) == 0) {
+				return;
+			}
+			size_t address = _lane.address();
+			auto in_range = address < _lane.ram_size();
+			if (control & WordLayout::BUS_WRITE) {
+				if (in_range) {
+					_lane.ram(address) = _lane.data();
+				}
+			} else {
+				_lane.data() = in_range ? _lane.ram(address) : 0;
+			}
+		}
+
+		WordTick tick_cpu() {
+			using namespace WordLayout;
+			_lane.control() &= ~(BUS_ENABLED | BUS_WRITE);
+			if (is_terminated()) {
+				return WordTick::Stopped;
+			}
+			auto step = _lane.cpu(SS) & PS_MASK;
+			switch (step) {
+				case Tick::Fetch:
+					request_read(_lane.cpu(IP));
+					inc_step();
+					break;
+
+				case Tick::Decode: {
+					auto code = _lane.data();
+					_lane.cpu(CC) = code;
+					auto args = get_arguments(code);
+					if (args < 0) {
+						raise_fatal();
+					} else if (args == 0) {
+						set_step(Tick::Execute_1);
+					} else {
+						set_step(Tick::Read_1);
+						set_flag(SS, AM_BIT, args > 1);
+						request_read(uint32_t(_lane.cpu(IP)) + 1);
+					}
+					break;
+				}
+
+				case Tick::Read_1:
+					_lane.cpu(A1) = _lane.data();
+					if (_lane.cpu(SS) & AM_BIT) {
+						set_step(Tick::Read_2);
+						request_read(uint32_t(_lane.cpu(IP)) + 2);
+					} else {
+						set_step(Tick::Execute_1);
+					}
+					break;
+
+				case Tick::Read_2:
+					_lane.cpu(A2) = _lane.data();
+					inc_step();
+					break;
+
+				case Tick::Execute_1:
+				case Tick::Execute_2: {
+					auto code = _lane.cpu(CC);
+					if (get_arguments(code) < 0) {
+						raise_fatal();
+						break;
+					}
+					auto first = (step == Tick::Execute_1);
+					auto done = true;
+					if (!execute(code, first ? 0 : 1, done)) {
+						return WordTick::Invalid;
+					}
+					if (is_terminated()) {
+						raise_fatal();
+					} else if (first && !done) {
+						inc_step();
+					} else {
+						finish_steps();
+					}
+					break;
+				}
+
+				default:
+					raise_fatal();
+			}
+			return is_terminated() ? WordTick::Stopped : WordTick::Running;
+		}
+
+	private:
+		Lane& _lane;
+
+		bool is_terminated() {
+			return (_lane.cpu(WordLayout::FS) & WordLayout::TR_BIT) != 0;
+		}
+
+		void set_flag(size_t index, NativeWord bit, bool value) {
+			auto& word = _lane.cpu(index);
+			word = value ? NativeWord(word | bit) : NativeWord(word & ~bit);
+		}
+
+		void set_step(NativeWord step) {
+			auto& ss = _lane.cpu(WordLayout::SS);
+			ss = NativeWord((ss & ~WordLayout::PS_MASK) | step);
+		}
+
+		// Pipeline state is a 3-bit register, its increment updates Overflow flag too
+		void inc_step() {
+			auto step = _lane.cpu(WordLayout::SS) & WordLayout::PS_MASK;
+			set_step((step + 1) & WordLayout::PS_MASK);
+			set_flag(WordLayout::FS, WordLayout::OF_BIT, step == WordLayout::PS_MASK);
+		}
+
+		void finish_steps() {
+			set_step(0);
+			set_flag(WordLayout::SS, WordLayout::AM_BIT, false);
+			_lane.cpu(WordLayout::CC) = 0;
+			_lane.cpu(WordLayout::A1) = 0;
+			_lane.cpu(WordLayout::A2) = 0;
+		}
+
+		void raise_fatal() {
+			_lane.cpu(WordLayout::FS) |= WordLayout::FT_BIT | WordLayout::TR_BIT;
+		}
+
+		void request_read(uint32_t address) {
+			_lane.control() = NativeWord((_lane.control() & ~WordLayout::BUS_WRITE) | WordLayout::BUS_ENABLED);
+			_lane.address() = NativeWord(address & WORD_MASK);
+			_lane.data()    = 0;
+		}
+
+		void request_write(uint32_t address, NativeWord value) {
+			_lane.control() |= WordLayout::BUS_ENABLED | WordLayout::BUS_WRITE;
+			_lane.address() = NativeWord(address & WORD_MASK);
+			_lane.data()    = value;
+		}
+
+		bool add(size_t index, uint32_t value) {
+			auto sum = uint64_t(_lane.cpu(index)) + value;
+			_lane.cpu(index) = NativeWord(sum & WORD_MASK);
+			auto overflow = sum > WORD_MASK;
+			set_flag(WordLayout::FS, WordLayout::OF_BIT, overflow);
+			return overflow;
+		}
+
+		void sub(size_t index, uint32_t value) {
+			auto old_value = uint32_t(_lane.cpu(index));
+			_lane.cpu(index) = NativeWord((old_value - value) & WORD_MASK);
+			set_flag(WordLayout::FS, WordLayout::OF_BIT, old_value < value);
+		}
+
+		void inc_counter() {
+			add(WordLayout::CR, 1);
+		}
+
+		void set_next_op(size_t args) {
+			inc_counter();
+			if (add(WordLayout::IP, uint32_t(1 + args))) {
+				raise_fatal();
+			}
+		}
+
+		// Returns false when common register index is out of range
+		bool execute(NativeWord code, int step, bool& done) {
+			using namespace WordLayout;
+			auto x = _lane.cpu(A1);
+			auto y = _lane.cpu(A2);
+			auto cn_count = _lane.cpu_size() - SERVICE_REGISTERS;
+			auto valid = [&](NativeWord index) { return index < cn_count; };
+			auto cn = [&](NativeWord index) -> NativeWord& { return _lane.cpu(SERVICE_REGISTERS + index); };
+
+			switch (code) {
+				case Command::NOOP:
+					set_next_op(0);
+					break;
+				case Command::RST:
+					_lane.cpu(FS) |= TR_BIT;
+					set_next_op(0);
+					break;
+				case Command::CLR:
+					if (!valid(x)) return false;
+					cn(x) = 0;
+					set_next_op(1);
+					break;
+				case Command::INC:
+					if (!valid(x)) return false;
+					add(SERVICE_REGISTERS + x, 1);
+					set_next_op(1);
+					break;
+				case Command::SUM: {
+					if (!valid(x) || !valid(y)) return false;
+					auto sum = uint64_t(cn(x)) + cn(y);
+					set_flag(FS, OF_BIT, sum > WORD_MASK);
+					_lane.cpu(AR) = NativeWord(sum & WORD_MASK);
+					set_next_op(2);
+					break;
+				}
+				case Command::MOV:
+					if (!valid(x) || !valid(y)) return false;
+					cn(y) = cn(x);
+					set_next_op(2);
+					break;
+				case Command::CLRA:
+					_lane.cpu(AR) = 0;
+					set_next_op(0);
+					break;
+				case Command::INCA:
+					add(AR, 1);
+					set_next_op(0);
+					break;
+				case Command::ADDA:
+					add(AR, x);
+					set_next_op(1);
+					break;
+				case Command::LD:
+					if (step == 0) {
+						if (!valid(x)) return false;
+						request_read(cn(x));
+						done = false;
+					} else {
+						if (!valid(y)) return false;
+						cn(y) = _lane.data();
+						set_next_op(2);
+					}
+					break;
+				case Command::ST:
+					if (!valid(x) || !valid(y)) return false;
+					request_write(cn(y), cn(x));
+					set_next_op(2);
+					break;
+				case Command::SUB:
+					if (!valid(x) || !valid(y)) return false;
+					sub(SERVICE_REGISTERS + x, cn(y));
+					set_next_op(2);
+					break;
+				case Command::SUBA:
+					if (!valid(x)) return false;
+					sub(AR, cn(x));
+					set_next_op(1);
+					break;
+				case Command::DEC:
+					if (!valid(x)) return false;
+					sub(SERVICE_REGISTERS + x, 1);
+					set_next_op(1);
+					break;
+				case Command::DECA:
+					sub(AR, 1);
+					set_next_op(0);
+					break;
+				case Command::JMP:
+					inc_counter();
+					_lane.cpu(IP) = x;
+					break;
+				case Command::LDA:
+					if (step == 0) {
+						if (!valid(x)) return false;
+						request_read(cn(x));
+						done = false;
+					} else {
+						_lane.cpu(AR) = _lane.data();
+						set_next_op(1);
+					}
+					break;
+				case Command::STA:
+					if (!valid(x)) return false;
+					request_write(cn(x), _lane.cpu(AR));
+					set_next_op(1);
+					break;
+				case Command::CMP:
+					if (!valid(x) || !valid(y)) return false;
+					set_flag(FS, ZF_BIT, cn(x) == cn(y));
+					set_next_op(2);
+					break;
+				case Command::JZ:
+					if (_lane.cpu(FS) & ZF_BIT) {
+						inc_counter();
+						_lane.cpu(IP) = x;
+					} else {
+						set_next_op(1);
+					}
+					break;
+				case Command::SET:
+					if (!valid(y)) return false;
+					cn(y) = x;
+					set_next_op(2);
+					break;
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include "Batch.h"
+#include "BitSlice.h"
+#include "Fleet.h"
+#include "CpuCommands.h"
+#include "DynamicComputer.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using Logics::Command;
+
+namespace Benchmarks {
+	using Clock = std::chrono::steady_clock;
+
+	double get_seconds(Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// 1, 2, 4 ... up to max (max is always included)
+	size_t next_thread_count(size_t threads, size_t max_threads) {
+		return (threads < max_threads) ? std::min(threads * 2, max_threads) : max_threads + 1;
+	}
+
+	// Count down loop, ~550 ticks per run:
+	// 0x00: SET 0x20 0x00 => r[0] = 32
+	// 0x03: SET 0x00 0x01 => r[1] = 0
+	// 0x06: DEC 0x00
+	// 0x08: CMP 0x00 0x01
+	// 0x0B: JZ  0x0F
+	// 0x0D: JMP 0x06
+	// 0x0F: RST
+	template<size_t RMS>
+	WordSet<RMS> make_countdown() {
+		static_assert(RMS >= 16);
+		return {
+			Word(Command::SET), Word(0x20), Word(0x00),
+			Word(Command::SET), Word(0x00), Word(0x01),
+			Word(Command::DEC), Word(0x00),
+			Word(Command::CMP), Word(0x00), Word(0x01),
+			Word(Command::JZ),  Word(0x0F),
+			Word(Command::JMP), Word(0x06),
+			Word(Command::RST),
+		};
+	}
+
+	// Jobs/sec of Fleet::Executor for 1, 2, 4 ... hardware threads
+	template<size_t IMS, size_t RMS>
+	void fleet(size_t job_count) {
+		vector<Fleet::Job<IMS, RMS>> jobs(job_count);
+		for (size_t i = 0; i < job_count; i++) {
+			jobs[i].Id = i;
+			jobs[i].Program.Ram = make_countdown<RMS>();
+		}
+		auto max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		double base_rate = 0;
+		cout << "threads, jobs/sec, speedup" << endl;
+		for (size_t threads = 1; threads <= max_threads; threads = next_thread_count(threads, max_threads)) {
+			auto executor = Fleet::Executor<IMS, RMS>(threads);
+			auto start = Clock::now();
+			auto results = executor.run(jobs);
+			auto rate = results.size() / get_seconds(start);
+			if (threads == 1) {
+				base_rate = rate;
+			}
+			cout << threads << ", " << static_cast<uint64_t>(rate) << ", " << rate / base_rate << endl;
+		}
+	}
+
+	// Machines/sec of one image run on many machines:
+	// separate Computers, BatchComputer lane by lane and vectorized
+	template<size_t IMS, size_t RMS>
+	void batch(size_t lanes) {
+		Images::Image<IMS, RMS> image;
+		image.Ram = make_countdown<RMS>();
+
+		auto start = Clock::now();
+		for (size_t i = 0; i < lanes; i++) {
+			auto cmp = Computer<IMS, RMS>(image.Ram);
+			image.apply(cmp);
+			while (cmp.tick()) { }
+		}
+		auto base_rate = lanes / get_seconds(start);
+		cout << "engine, machines/sec, speedup" << endl;
+		cout << "computer, " << static_cast<uint64_t>(base_rate) << ", 1" << endl;
+
+		for (auto vectorized : { false, true }) {
+			auto machines = Batch::BatchComputer<IMS, RMS>(lanes);
+			for (size_t i = 0; i < lanes; i++) {
+				machines.load(i, image);
+			}
+			machines.set_vectorized(vectorized);
+			start = Clock::now();
+			machines.run();
+			auto rate = lanes / get_seconds(start);
+			cout << (vectorized ? "batch, " : "batch scalar, ") << static_cast<uint64_t>(rate) << ", " << rate / base_rate << endl;
+		}
+	}
+
+	// Machines/sec of the templated Computer and DynamicComputer running the same image,
+	// Computer is slow, so it runs 1/16 of the machines; DynamicComputer is measured a few times
+	// and the best rate is taken
+	template<size_t IMS, size_t RMS>
+	void dynamic(size_t machines) {
+		const size_t REPEATS = 3;
+		Images::Image<IMS, RMS> image;
+		image.Ram = make_countdown<RMS>();
+
+		auto start = Clock::now();
+		for (size_t i = 0; i < machines / 16; i++) {
+			auto cmp = Computer<IMS, RMS>(image.Ram);
+			image.apply(cmp);
+			while (cmp.tick()) { }
+		}
+		auto base_rate = (machines / 16) / get_seconds(start);
+		cout << "engine, machines/sec, speedup" << endl;
+		cout << "computer, " << static_cast<uint64_t>(base_rate) << ", 1" << endl;
+
+		double rate = 0;
+		for (size_t repeat = 0; repeat < REPEATS; repeat++) {
+			start = Clock::now();
+			for (size_t i = 0; i < machines; i++) {
+				auto cmp = Core::DynamicComputer::from_image(image);
+				while (cmp.tick()) { }
+			}
+			rate = std::max(rate, machines / get_seconds(start));
+		}
+		cout << "dynamic, " << static_cast<uint64_t>(rate) << ", " << rate / base_rate << endl;
+	}
+
+	// Bytes per idle machine: computers built from one image and forks of one computer,
+	// object size plus pages and page tables owned by the machine only (lower bound, see get_instance_bytes)
+	template<size_t IMS, size_t RMS>
+	void footprint(size_t machines) {
+		using Machine = Computer<IMS, RMS>;
+		const auto MILLION = 1000000.0;
+		auto ram = make_countdown<RMS>();
+		vector<Machine> fresh;
+		vector<Machine> forks;
+		fresh.reserve(machines);
+		forks.reserve(machines);
+		size_t fresh_bytes = 0;
+		size_t fork_bytes  = 0;
+		for (size_t i = 0; i < machines; i++) {
+			fresh.emplace_back(ram);
+			fresh_bytes += fresh.back().get_instance_bytes();
+		}
+		for (size_t i = 0; i < machines; i++) {
+			forks.push_back(fresh.front().fork());
+			fork_bytes += forks.back().get_instance_bytes();
+		}
+		cout << "machines, object bytes, bytes/machine, MB per million" << endl;
+		cout << "fresh, " << sizeof(Machine) << ", " << fresh_bytes / machines << ", " << fresh_bytes * (MILLION / machines) / (1 << 20) << endl;
+		cout << "forks, " << sizeof(Machine) << ", " << fork_bytes / machines << ", " << fork_bytes * (MILLION / machines) / (1 << 20) << endl;
+	}
+
+	// Exhaustive check of BitUtils gate model at given width, full adders (or inverters)/sec
+	void bits(size_t width) {
+		using BitSlice::Operation;
+		cout << "operation, width, combinations, mismatches, seconds, combinations/sec, gates/sec" << endl;
+		for (auto operation : { Operation::Inverse, Operation::Plus, Operation::Minus }) {
+			auto start = Clock::now();
+			auto report = BitSlice::verify(operation, width);
+			auto seconds = get_seconds(start);
+			auto rate = report.Checked / seconds;
+			cout << BitSlice::to_string(operation) << ", " << width << ", " << report.Checked << ", " << report.Mismatches << ", ";
+			cout << seconds << ", " << static_cast<uint64_t>(rate) << ", " << static_cast<uint64_t>(rate * width) << endl;
+		}
+	}
+
+	bool run(const string& name) {
+		if (name == "fleet") {
+			fleet<10, 16>(2000);
+			return true;
+		}
+		if (name == "batch") {
+			batch<10, 16>(1024);
+			return true;
+		}
+		if (name == "dynamic") {
+			dynamic<10, 16>(100000);
+			return true;
+		}
+		if (name == "footprint") {
+			footprint<10, 16>(100000);
+			return true;
+		}
+		if (name == "bits") {
+			bits(BitSlice::MAX_WIDTH);
+			return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <condition_variable>
+
+#include "Image.h"
+#include "Computer.h"
+#include "Instrumentation.h"
+
+#include "View.h"
+#include "Options.h"
+
+using std::cin;
+using std::cout;
+using std::endl;
+using std::mutex;
+using std::atomic;
+using std::string;
+using std::thread;
+using std::optional;
+using std::shared_ptr;
+using std::lock_guard;
+using std::unique_lock;
+using std::condition_variable;
+
+using Core::Computer;
+using Instrumentation::InstructionCounter;
+
+namespace ProcFrontend {
+	// Keyboard commands shared between input, engine and display threads
+	// Input thread is detached (blocking read can't be interrupted), so it owns a shared copy
+	class LiveControls {
+	public:
+		atomic<bool>   Paused = { false };
+		atomic<bool>   Quit   = { false };
+		atomic<size_t> Steps  = { 0 };
+
+		mutex              Mutex;
+		condition_variable Changed;
+
+		void apply(const string& command) {
+			if (command == "p") {
+				Paused = true;
+			} else if (command == "s") {
+				Paused = true;
+				Steps++;
+			} else if (command == "c") {
+				Paused = false;
+			} else if (command == "q") {
+				Quit = true;
+			}
+			lock_guard<mutex> lock(Mutex);
+			Changed.notify_all();
+		}
+	};
+
+	// Engine runs on its own thread at full speed, display thread samples
+	// a copy of the whole machine at fixed refresh rate and renders it with View.
+	// Engine only publishes a snapshot when it was requested and the slot is free (try_lock),
+	// so it never waits for rendering.
+	template<size_t IMS, size_t RMS>
+	class LiveSession {
+		using Clock   = std::chrono::steady_clock;
+		using Machine = Computer<IMS, RMS, InstructionCounter>;
+
+		class Snapshot {
+		public:
+			optional<Machine> Value;
+			uint64_t          Version = 0;
+			uint64_t          Ticks   = 0;
+			bool              Running = true;
+			Clock::time_point Time;
+		};
+
+	public:
+		LiveSession(const Images::Image<IMS, RMS>& image, size_t refresh_rate, bool use_color = false):
+			_machine(image.Ram), _period(std::chrono::milliseconds(1000 / std::max<size_t>(refresh_rate, 1))), _use_color(use_color) {
+			image.apply(_machine);
+		}
+
+		int run() {
+			cout << "Live mode: p - pause, s - step, c - continue, q - quit" << endl;
+			auto controls = _controls;
+			thread([controls]() {
+				string command;
+				while (!controls->Quit && std::getline(cin, command)) {
+					controls->apply(command);
+				}
+			}).detach();
+
+			auto engine = thread(&LiveSession::run_engine, this);
+			run_display();
+			_controls->Quit = true;
+			_controls->apply("");
+			engine.join();
+			// Engine is joined, machine state is ours to read
+			auto fatal = _machine.State.CPU[_machine.Registers.Fatal].test(0);
+			return fatal ? ExitCode::Fatal : ExitCode::Ok;
+		}
+
+	private:
+		Machine                  _machine;
+		const Clock::duration    _period;
+		const bool               _use_color;
+		shared_ptr<LiveControls> _controls = std::make_shared<LiveControls>();
+		atomic<bool>             _requested = { true };
+		mutex                    _slot_mutex;
+		Snapshot                 _slot;
+
+		void run_engine() {
+			auto& controls = *_controls;
+			uint64_t ticks = 0;
+			auto running = true;
+			while (running && !controls.Quit) {
+				if (controls.Paused) {
+					if (controls.Steps == 0) {
+						unique_lock<mutex> lock(controls.Mutex);
+						controls.Changed.wait(lock, [&] { return !controls.Paused || (controls.Steps > 0) || controls.Quit; });
+						continue;
+					}
+					// Single step is not time critical, always show its result
+					controls.Steps--;
+					running = _machine.tick();
+					ticks++;
+					lock_guard<mutex> lock(_slot_mutex);
+					publish(ticks, running);
+					continue;
+				}
+				running = _machine.tick();
+				ticks++;
+				if (_requested.load(std::memory_order_relaxed)) {
+					try_publish(ticks, running);
+				}
+			}
+			// Final state must reach display, here waiting is fine
+			lock_guard<mutex> lock(_slot_mutex);
+			publish(ticks, running);
+		}
+
+		void try_publish(uint64_t ticks, bool running) {
+			if (_slot_mutex.try_lock()) {
+				publish(ticks, running);
+				_slot_mutex.unlock();
+			}
+		}
+
+		void publish(uint64_t ticks, bool running) {
+			_slot.Value.emplace(_machine);
+			_slot.Version++;
+			_slot.Ticks   = ticks;
+			_slot.Running = running;
+			_slot.Time    = Clock::now();
+			_requested = false;
+		}
+
+		void run_display() {
+			auto renderer = View::StateRenderer<IMS, RMS>(_use_color);
+			optional<Machine> shown;
+			uint64_t shown_version = 0;
+			uint64_t prev_executed = 0;
+			auto prev_time = Clock::now();
+			auto running = true;
+			while (running && !_controls->Quit) {
+				std::this_thread::sleep_for(_period);
+				Snapshot snapshot;
+				{
+					lock_guard<mutex> lock(_slot_mutex);
+					if (_slot.Version == shown_version) {
+						_requested = true;
+						continue;
+					}
+					shown.emplace(*_slot.Value);
+					shown_version = _slot.Version;
+					snapshot.Ticks   = _slot.Ticks;
+					snapshot.Running = _slot.Running;
+					snapshot.Time    = _slot.Time;
+				}
+				_requested = true;
+				running = snapshot.Running;
+
+				auto executed = shown->get_probe().Executed;
+				auto seconds = std::chrono::duration<double>(snapshot.Time - prev_time).count();
+				auto rate = (seconds > 0) ? (executed - prev_executed) / seconds : 0.0;
+				prev_executed = executed;
+				prev_time = snapshot.Time;
+
+				cout << "=== Ticks: " << snapshot.Ticks << ", instructions: " << executed;
+				cout << ", instructions/sec: " << static_cast<uint64_t>(rate);
+				cout << (running ? (_controls->Paused ? " (paused)" : "") : " (done)") << endl;
+				renderer.render(*shown, cout, true);
+				cout << endl;
+			}
+		}
+	};
+}
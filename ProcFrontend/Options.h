@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cctype>
+#include <string>
+#include <ostream>
+
+using std::endl;
+using std::string;
+using std::ostream;
+
+namespace ProcFrontend {
+	// Process exit codes
+	namespace ExitCode {
+		const int Ok         = 0;
+		const int Fatal      = 1; // execution ended with Fatal flag set
+		const int TickLimit  = 2; // stopped by --max-ticks
+		const int Usage      = 3; // invalid options or unknown benchmark
+		const int BadInput   = 4; // image, manifest, batch or merge sources can't be loaded
+		const int IoError    = 5; // shard results or shared memory state can't be read or written
+		const int Incomplete = 6; // merged results miss jobs
+	}
+
+	class Options {
+	public:
+		bool   Valid       = true;
+		bool   TestOnly    = false; // run tests with all logs and exit
+		bool   Headless    = false; // run to termination without waiting for input
+		bool   SkipTests   = false; // do not run unit tests at startup, shard runs never do
+		bool   Quiet       = false; // no per-tick output
+		bool   SummaryOnly = false; // print only final status, tick count and wall time
+		bool   Color       = true;  // highlight changes when output is a terminal
+		bool   Live        = false; // engine on its own thread, display samples state
+		size_t RefreshRate = 10;    // live display refreshes per second
+		size_t MaxTicks    = 0;     // 0 - unlimited
+		string ImagePath   = "../raw_mem.txt";
+		string BatchPath;           // directory or manifest with images to run one by one
+		string Benchmark;           // benchmark name to run
+		size_t Readers     = 2;     // batch image reader threads
+		size_t TestThreads = 0;     // unit test threads, 0 - hardware threads
+		string PublishName;         // shared memory segment the headless run publishes state to
+		string MonitorName;         // shared memory segment to sample state from
+		string ManifestPath;        // job manifest to run a shard of
+		string Shard       = "0/1"; // shard of the manifest, k/n
+		string ResultsPath;         // shard results to append to, or merged results to write
+		string MergePath;           // directory or list of shard results to merge
+	};
+
+	void print_usage(ostream& os) {
+		os << "Usage: CppProc [test_only_mode] [options]" << endl;
+		os << "  --image <path>     RAM image to load (default: ../raw_mem.txt)" << endl;
+		os << "  --headless         run to termination without waiting for input" << endl;
+		os << "  --max-ticks <n>    stop after n ticks (exit code 2)" << endl;
+		os << "  --skip-tests       do not run unit tests at startup (always skipped with --manifest)" << endl;
+		os << "  --test-threads <n> threads running unit tests (default: hardware threads)" << endl;
+		os << "  --quiet            no per-tick output (implies --headless)" << endl;
+		os << "  --summary-only     print only final summary (implies --quiet)" << endl;
+		os << "  --live             run engine on its own thread, display samples state" << endl;
+		os << "  --refresh <hz>     live display refresh rate (default: 10)" << endl;
+		os << "  --no-color         do not highlight changes on terminals" << endl;
+		os << "  --batch <path>     run every image from directory or manifest file" << endl;
+		os << "  --readers <n>      batch image reader threads (default: 2)" << endl;
+		os << "  --bench <name>     run benchmark: fleet, batch, dynamic, footprint, bits" << endl;
+		os << "  --publish <name>   publish headless run state to shared memory /name" << endl;
+		os << "  --monitor <name>   print state published to shared memory /name" << endl;
+		os << "  --manifest <path>  run a shard of the job manifest, results go to --results" << endl;
+		os << "  --shard <k>/<n>    shard of the manifest (default: 0/1)" << endl;
+		os << "  --results <path>   shard results file (resumed if present) or merged output" << endl;
+		os << "  --merge <path>     merge shard results from directory or list file into --results" << endl;
+		os << "Exit codes: 0 - terminated, 1 - Fatal flag set, 2 - tick limit reached," << endl;
+		os << "            3 - invalid options, 4 - image or sources can't be loaded," << endl;
+		os << "            5 - results or shared memory can't be accessed, 6 - merged results miss jobs." << endl;
+	}
+
+	// Decimal digits only: stoull alone skips spaces, wraps "-5" and stops at "10x"
+	bool parse_number(const string& str, size_t& value) {
+		if (str.empty() || !std::isdigit(static_cast<unsigned char>(str[0]))) {
+			return false;
+		}
+		try {
+			size_t end = 0;
+			value = std::stoull(str, &end);
+			return end == str.size();
+		} catch (std::exception&) {
+			return false;
+		}
+	}
+
+	Options parse_options(int argc, char* argv[]) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			auto has_value = (i + 1 < argc);
+			if (arg == "test_only_mode") {
+				options.TestOnly = true;
+			} else if (arg == "--headless") {
+				options.Headless = true;
+			} else if (arg == "--skip-tests") {
+				options.SkipTests = true;
+			} else if (arg == "--quiet") {
+				options.Headless = true;
+				options.Quiet    = true;
+			} else if (arg == "--summary-only") {
+				options.Headless    = true;
+				options.Quiet       = true;
+				options.SummaryOnly = true;
+			} else if ((arg == "--image") && has_value) {
+				options.ImagePath = argv[++i];
+			} else if (arg == "--no-color") {
+				options.Color = false;
+			} else if (arg == "--live") {
+				options.Live = true;
+			} else if ((arg == "--max-ticks") && has_value) {
+				options.Valid = options.Valid && parse_number(argv[++i], options.MaxTicks);
+			} else if ((arg == "--batch") && has_value) {
+				options.BatchPath = argv[++i];
+			} else if ((arg == "--bench") && has_value) {
+				options.Benchmark = argv[++i];
+			} else if ((arg == "--test-threads") && has_value) {
+				options.Valid = options.Valid && parse_number(argv[++i], options.TestThreads);
+			} else if ((arg == "--readers") && has_value) {
+				options.Valid = options.Valid && parse_number(argv[++i], options.Readers);
+			} else if ((arg == "--publish") && has_value) {
+				options.PublishName = argv[++i];
+			} else if ((arg == "--monitor") && has_value) {
+				options.MonitorName = argv[++i];
+			} else if ((arg == "--manifest") && has_value) {
+				options.ManifestPath = argv[++i];
+			} else if ((arg == "--shard") && has_value) {
+				options.Shard = argv[++i];
+			} else if ((arg == "--results") && has_value) {
+				options.ResultsPath = argv[++i];
+			} else if ((arg == "--merge") && has_value) {
+				options.MergePath = argv[++i];
+			} else if ((arg == "--refresh") && has_value) {
+				options.Valid = options.Valid && parse_number(argv[++i], options.RefreshRate);
+			} else {
+				options.Valid = false;
+			}
+		}
+		auto sharded = !options.ManifestPath.empty() || !options.MergePath.empty();
+		options.Valid = options.Valid && (!sharded || !options.ResultsPath.empty());
+		return options;
+	}
+}
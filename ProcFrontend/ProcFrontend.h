@@ -1,12 +1,19 @@
 #include <bitset>
-#include <fstream>
+#include <chrono>
 #include <iostream>
 
+#include "Image.h"
+#include "Shards.h"
 #include "Tests.h"
+#include "Ingestion.h"
+#include "LiveState.h"
 #include "RegisterSet.h"
 #include "ComputerState.h"
 
 #include "View.h"
+#include "Options.h"
+#include "Benchmarks.h"
+#include "LiveSession.h"
 
 const size_t InternalMemorySize = 10;
 const size_t RamMemorySize      = 16;
@@ -14,100 +21,323 @@ const size_t RamMemorySize      = 16;
 using std::cin;
 using std::cout;
 using std::bitset;
-using std::ifstream;
 
 using Core::Computer;
 using Architecture::WordSet;
 
 namespace ProcFrontend {
-	auto read_ram() {
-		WordSet<RamMemorySize> result;
-		
-		auto path = "../raw_mem.txt";
-		cout << "Try to read memory from file: " << path << endl;
-		auto f = ifstream(path, std::ios::binary | std::ios::in);
-		if (f.is_open()) {
-			cout << "File is opened." << endl;
-			size_t i = 0;
-			size_t j = 0;
-			char c;
-			auto set = Word { 0 };
-			while (f.get(c)) {
-				if (i >= RamMemorySize) {
-					break;
-				}
-				if (c == '1') {
-					set.set(i);
-					j++;
-				} else if (c == '0') {
-					j++;
-				}
-				if ( j == Architecture::WORD_SIZE ) {
-					result[i] = set;
-					set = Word { 0 };
-					j = 0;
-					i++;
-				}
-			}
-			cout << "End of file." << endl;
+	using Machine = Computer<InternalMemorySize, RamMemorySize>;
+
+	using MachineImage = Images::Image<InternalMemorySize, RamMemorySize>;
+
+	bool read_image(const string& path, bool verbose, MachineImage& image) {
+		if (verbose) {
+			cout << "Try to read memory from file: " << path << endl;
+		}
+		auto [ok, error] = Images::load(path, image);
+		if (!ok) {
+			cerr << "Can't load image: " << error << endl;
+		} else if (verbose) {
+			cout << "Image is loaded." << endl;
 			cout << endl;
-			f.close();
-		} else {
-			cout << "Can't open file." << endl;
 		}
-		return result;
+		return ok;
 	}
 
-	void run_tests() {
+	void run_tests(size_t threads, bool logs) {
 		cerr << "Run tests:" << endl;
-		Tests::test_all();
+		Tests::test_all(threads, logs);
 		cerr << endl;
 	}
 
-	int start(int argc, char* argv[]) {
-		auto is_test_only_mode = false;
-		if (argc > 1) {
-			string arg = argv[1];
-			is_test_only_mode = (arg == "test_only_mode");
-		}
-		
-		cout << "=== CppProc ===" << endl;
-		if (is_test_only_mode) {
-			cout << "Test Only Mode" << endl;
-			Utils::enable_all_logs();
-		}
-		cout << endl;
-		
-		run_tests();
-		
-		if (is_test_only_mode) {
-			return 0;
-		}
-		
-		auto ram_mem = read_ram();
-		auto comp = Computer<InternalMemorySize, RamMemorySize>(ram_mem);
-		
+	// Enter - next tick, "f" - full state dump, "q" - quit
+	int run_interactive(Machine& comp, const Options& options) {
 		cout << "Start execution..." << endl;
+		cout << "Enter - next tick, f - full dump, q - quit" << endl;
 		cout << endl;
-		
+
+		auto renderer = View::StateRenderer<InternalMemorySize, RamMemorySize>(View::use_color(options.Color));
+		cout << "State:" << endl;
+		renderer.render(comp, cout);
+
 		auto running = true;
-		while (running) {
-			cout << "State:" << endl;
-			View::print_state(comp);
-			
-			cout << endl;
+		string command;
+		while (running && std::getline(cin, command)) {
+			if (command == "q") {
+				break;
+			}
+			if (command == "f") {
+				cout << "State:" << endl;
+				View::print_state(comp);
+				cout << endl;
+				continue;
+			}
+
 			cout << "Operations:" << endl;
 			Utils::enable_all_logs();
 			running = comp.tick();
 			Utils::disable_log();
 			cout << endl;
-			
+
+			cout << "Changes:" << endl;
+			renderer.render(comp, cout);
+			cout << endl;
+
 			if (!running) {
-				cout << endl << "Execution done." << endl;
+				cout << "Execution done." << endl;
 			}
-			cin.get();
 		}
-		return 0;
+		auto fatal = comp.State.CPU[comp.Registers.Fatal].test(0);
+		return fatal ? ExitCode::Fatal : ExitCode::Ok;
+	}
+
+	const char* get_status(bool running, bool fatal) {
+		return running ? "tick limit reached" : (fatal ? "fatal" : "terminated");
+	}
+
+	// Images from directory or manifest are loaded in background and executed one by one
+	int run_batch(const Options& options) {
+		using Clock = std::chrono::steady_clock;
+
+		vector<string> paths;
+		auto [listed, list_error] = Images::list_sources(options.BatchPath, paths);
+		if (!listed) {
+			cerr << list_error << endl;
+			return ExitCode::BadInput;
+		}
+		auto ingestion = Images::Ingestion<InternalMemorySize, RamMemorySize>(paths, options.Readers);
+		auto item = Images::Ingestion<InternalMemorySize, RamMemorySize>::Item();
+		size_t failed = 0;
+		size_t fatal_count = 0;
+		size_t total_ticks = 0;
+		auto start_time = Clock::now();
+		while (ingestion.pop(item)) {
+			if (!item.Ok) {
+				failed++;
+				cerr << item.Path << ": " << item.Error << endl;
+				continue;
+			}
+			auto comp = Machine(item.Value.Ram);
+			item.Value.apply(comp);
+			size_t ticks = 0;
+			auto running = true;
+			while (running && ((options.MaxTicks == 0) || (ticks < options.MaxTicks))) {
+				running = comp.tick();
+				ticks++;
+			}
+			auto fatal = comp.State.CPU[comp.Registers.Fatal].test(0);
+			fatal_count += fatal ? 1 : 0;
+			total_ticks += ticks;
+			if (!options.SummaryOnly) {
+				cout << item.Index << " " << item.Path << ": " << get_status(running, fatal) << ", ticks: " << ticks << endl;
+			}
+		}
+		auto wall_time = std::chrono::duration<double, std::milli>(Clock::now() - start_time);
+
+		cout << "Images: " << paths.size() << " (failed to load: " << failed << ", fatal: " << fatal_count << ")" << endl;
+		cout << "Ticks: " << total_ticks << endl;
+		cout << "Wall time: " << wall_time.count() << " ms" << endl;
+		return (failed > 0) ? ExitCode::BadInput : ExitCode::Ok;
 	}
-}
 
+	// Runs shard k of n of the manifest, results are appended to options.ResultsPath
+	int run_shard(const Options& options) {
+		Shards::Shard shard;
+		if (!Shards::parse_shard(options.Shard, shard)) {
+			cerr << "Bad shard: " << options.Shard << endl;
+			return ExitCode::Usage;
+		}
+		Shards::Manifest manifest;
+		auto [loaded, load_error] = Shards::load_manifest(options.ManifestPath, manifest);
+		if (!loaded) {
+			cerr << load_error << endl;
+			return ExitCode::BadInput;
+		}
+		auto executor = Fleet::Executor<InternalMemorySize, RamMemorySize>();
+		Shards::ShardReport report;
+		auto [ok, error] = Shards::run_shard(manifest, shard, options.ResultsPath, options.MaxTicks, executor, report);
+		if (!ok) {
+			cerr << error << endl;
+			return ExitCode::IoError;
+		}
+		cout << "Shard " << shard.Index << "/" << shard.Count << ": " << report.Owned << " jobs";
+		cout << " (resumed: " << report.Resumed << ", run: " << report.Done << ")" << endl;
+		return ExitCode::Ok;
+	}
+
+	// Merges shard results into one file indexed by job
+	int run_merge(const Options& options) {
+		vector<string> paths;
+		auto [listed, list_error] = Images::list_sources(options.MergePath, paths);
+		if (!listed) {
+			cerr << list_error << endl;
+			return ExitCode::BadInput;
+		}
+		Shards::MergeReport report;
+		auto [ok, error] = Shards::merge(paths, options.ResultsPath, report);
+		if (!ok) {
+			cerr << error << endl;
+			return ExitCode::IoError;
+		}
+		cout << "Jobs: " << report.Jobs << " (found: " << report.Found << ", duplicates: " << report.Duplicates;
+		cout << ", corrupted: " << report.Corrupted << ")" << endl;
+		return (report.Found < report.Jobs) ? ExitCode::Incomplete : ExitCode::Ok;
+	}
+
+	const size_t PUBLISH_PERIOD = 1024; // ticks between publications of headless run state
+	const size_t STALE_PERIODS  = 50;   // monitor periods without new ticks before the publisher is given up
+
+	int run_headless(Machine& comp, const Options& options) {
+		using Clock = std::chrono::steady_clock;
+
+		LiveState::SharedFrame published;
+		if (!options.PublishName.empty()) {
+			auto [ok, error] = published.create(options.PublishName);
+			if (!ok) {
+				cerr << error << endl;
+				return ExitCode::IoError;
+			}
+		}
+		auto frame = published.get();
+
+		auto renderer = View::StateRenderer<InternalMemorySize, RamMemorySize>(View::use_color(options.Color));
+		size_t ticks = 0;
+		auto running = true;
+		auto start_time = Clock::now();
+		while (running && ((options.MaxTicks == 0) || (ticks < options.MaxTicks))) {
+			running = comp.tick();
+			ticks++;
+			if (!options.Quiet) {
+				cout << "Tick " << ticks << ":" << endl;
+				renderer.render(comp, cout);
+			}
+			if ((frame != nullptr) && (ticks % PUBLISH_PERIOD == 0)) {
+				LiveState::Writer(*frame).publish(comp, ticks);
+			}
+		}
+		if (frame != nullptr) {
+			LiveState::Writer(*frame).publish(comp, ticks, true);
+		}
+		auto wall_time = std::chrono::duration<double, std::milli>(Clock::now() - start_time);
+
+		auto fatal = comp.State.CPU[comp.Registers.Fatal].test(0);
+		auto status = get_status(running, fatal);
+		if (!options.SummaryOnly) {
+			cout << "Registers:" << endl;
+			View::print_registers(comp.Registers, comp.State);
+			cout << endl << "RAM Memory:" << endl;
+			View::print_memory(comp.State.RAM.get_all(), 4);
+			cout << endl;
+		}
+		cout << "Status: " << status << endl;
+		cout << "Ticks: " << ticks << endl;
+		cout << "Wall time: " << wall_time.count() << " ms" << endl;
+
+		if (fatal) {
+			return ExitCode::Fatal;
+		}
+		return running ? ExitCode::TickLimit : ExitCode::Ok;
+	}
+
+	// Samples state published by another process until its machine stops
+	int run_monitor(const Options& options) {
+		using namespace Logics::WordLayout;
+		LiveState::SharedFrame monitored;
+		auto [ok, error] = monitored.open(options.MonitorName);
+		if (!ok) {
+			cerr << error << endl;
+			return ExitCode::IoError;
+		}
+		auto period = std::chrono::milliseconds(1000 / std::max<size_t>(options.RefreshRate, 1));
+		LiveState::Sample sample;
+		// Torn reads are retried after the period, the loop goes on by the last consistent sample
+		// A publisher which crashed or hangs never leaves Running, so it is given up once ticks stop moving
+		auto state = LiveState::Status::Running;
+		uint64_t last_ticks = 0;
+		size_t stale = 0;
+		while (true) {
+			if (LiveState::read(*monitored.get(), sample)) {
+				state = sample.State;
+				cout << "Ticks: " << sample.Ticks << ", IP: " << sample.Cpu[IP] << ", counter: " << sample.Cpu[CR];
+				cout << ", flags: " << bitset<4>(sample.Cpu[FS]) << endl;
+			}
+			if (state != LiveState::Status::Running) {
+				break;
+			}
+			stale = (sample.Ticks == last_ticks) ? stale + 1 : 0;
+			last_ticks = sample.Ticks;
+			if (stale >= STALE_PERIODS) {
+				cerr << "Publisher stopped at tick " << last_ticks << ", no progress for " << STALE_PERIODS << " periods" << endl;
+				return ExitCode::IoError;
+			}
+			std::this_thread::sleep_for(period);
+		}
+		return ExitCode::Ok;
+	}
+
+	int start(int argc, char* argv[]) {
+		auto options = parse_options(argc, argv);
+		if (!options.Valid) {
+			print_usage(cerr);
+			return ExitCode::Usage;
+		}
+
+		if (!options.SummaryOnly) {
+			cout << "=== CppProc ===" << endl;
+			if (options.TestOnly) {
+				cout << "Test Only Mode" << endl;
+			}
+			cout << endl;
+		}
+
+		// Shard workers are started many times over a fleet, unit tests would only delay every one
+		auto shard_mode = !options.ManifestPath.empty();
+		if ((!options.SkipTests && !shard_mode) || options.TestOnly) {
+			run_tests(options.TestThreads, options.TestOnly);
+		}
+
+		if (options.TestOnly) {
+			return ExitCode::Ok;
+		}
+
+		if (!options.Benchmark.empty()) {
+			if (!Benchmarks::run(options.Benchmark)) {
+				cerr << "Unknown benchmark: " << options.Benchmark << endl;
+				print_usage(cerr);
+				return ExitCode::Usage;
+			}
+			return ExitCode::Ok;
+		}
+
+		if (!options.BatchPath.empty()) {
+			return run_batch(options);
+		}
+
+		if (!options.MergePath.empty()) {
+			return run_merge(options);
+		}
+
+		if (!options.ManifestPath.empty()) {
+			return run_shard(options);
+		}
+
+		if (!options.MonitorName.empty()) {
+			return run_monitor(options);
+		}
+
+		MachineImage image;
+		if (!read_image(options.ImagePath, !options.SummaryOnly, image)) {
+			return ExitCode::BadInput;
+		}
+		if (options.Live) {
+			return LiveSession<InternalMemorySize, RamMemorySize>(image, options.RefreshRate, View::use_color(options.Color)).run();
+		}
+		auto comp = Machine(image.Ram);
+		image.apply(comp);
+
+		if (options.Headless) {
+			return run_headless(comp, options);
+		}
+		return run_interactive(comp, options);
+	}
+}
@@ -1,20 +1,40 @@
 #pragma once
 
+#include <array>
 #include <bitset>
+#include <string>
 #include <iomanip>
+#include <ostream>
 #include <string_view>
 
+#ifndef _WIN32
+	#include <unistd.h>
+#endif
+
 #include "Computer.h"
 #include "Architecture.h"
 #include "ComputerState.h"
 
+using std::array;
 using std::bitset;
+using std::string;
+using std::ostream;
 
 using Core::Computer;
 using Architecture::Word;
 using State::ComputerState;
 
 namespace View {
+	// Changes are highlighted by escape sequences only when stdout is a terminal,
+	// redirected output stays plain text
+	bool use_color(bool allowed) {
+	#ifdef _WIN32
+		return false;
+	#else
+		return allowed && (::isatty(STDOUT_FILENO) != 0);
+	#endif
+	}
+
 	template<size_t TS>
 	void print_memory(const bitset<TS>& mem, int sizes_per_line) {
 		int sizes = 0;
@@ -73,8 +93,8 @@ namespace View {
 		print_register("DT", data.get_all());
 	}
 
-	template<size_t IMS, size_t RMS>
-	void print_state(const Computer<IMS, RMS>& cmp) {
+	template<size_t IMS, size_t RMS, class P>
+	void print_state(const Computer<IMS, RMS, P>& cmp) {
 		auto& state = cmp.State;
 		cout << "Registers:" << endl;
 		print_registers(cmp.Registers, state);
@@ -90,4 +110,118 @@ namespace View {
 		cout << endl << "RAM Memory:" << endl;
 		print_memory(state.RAM.get_all(), 4);
 	}
+
+	// Keeps previously rendered state and prints only changed registers,
+	// buses and memory words, formatted into one buffer and written at once
+	template<size_t IMS, size_t RMS>
+	class StateRenderer {
+		static constexpr size_t BUSES = 3;
+
+	public:
+		StateRenderer(bool use_color = false): _use_color(use_color) {
+			const char* service_names[] = { "SS", "CC", "A1", "A2", "FS", "Cr", "IP", "AR" };
+			for (size_t i = 0; i < IMS; i++) {
+				auto is_service = (i < Architecture::SERVICE_REGISTERS);
+				_cpu_names[i] = is_service ? service_names[i] : "C" + std::to_string(i - Architecture::SERVICE_REGISTERS);
+			}
+			for (size_t i = 0; i < RMS; i++) {
+				_ram_names[i] = "M";
+				append_number(_ram_names[i], i, 16, 2);
+			}
+		}
+
+		template<class P>
+		void render(const Computer<IMS, RMS, P>& cmp, ostream& os, bool full = false) {
+			auto& state = cmp.State;
+			auto cpu = state.CPU.get_all();
+			auto ram = state.RAM.get_all();
+			array<unsigned long, BUSES> buses = {
+				state.ControlBus.get_all().to_ulong(),
+				state.AddressBus.get_all().to_ulong(),
+				state.DataBus.get_all().to_ulong(),
+			};
+			full = full || !_has_prev;
+
+			_buffer.clear();
+			auto changes = 0;
+			for (size_t i = 0; i < IMS; i++) {
+				changes += render_entry(_cpu_names[i], get_word(cpu, i), _cpu[i], full);
+			}
+			for (size_t i = 0; i < BUSES; i++) {
+				changes += render_entry(BUS_NAMES[i], buses[i], _buses[i], full);
+			}
+			for (size_t i = 0; i < RMS; i++) {
+				changes += render_entry(_ram_names[i], get_word(ram, i), _ram[i], full);
+			}
+			if (!full && (changes == 0)) {
+				_buffer += "(no changes)\n";
+			}
+			_has_prev = true;
+			os.write(_buffer.data(), _buffer.size());
+		}
+
+	private:
+		static constexpr const char* BUS_NAMES[] = { "CL", "AD", "DT" };
+
+		const bool _use_color;
+
+		bool                        _has_prev = false;
+		array<unsigned long, IMS>   _cpu      = { 0 };
+		array<unsigned long, BUSES> _buses    = { 0 };
+		array<unsigned long, RMS>   _ram      = { 0 };
+		array<string, IMS>          _cpu_names;
+		array<string, RMS>          _ram_names;
+		string                      _buffer;
+
+		template<size_t TS>
+		static unsigned long get_word(const bitset<TS>& mem, size_t index) {
+			unsigned long value = 0;
+			auto offset = index * Architecture::WORD_SIZE;
+			for (size_t i = Architecture::WORD_SIZE; i > 0; i--) {
+				value = (value << 1) | (mem[offset + i - 1] ? 1 : 0);
+			}
+			return value;
+		}
+
+		// Returns 1 if value is changed since previous render
+		int render_entry(const string_view& name, unsigned long value, unsigned long& prev, bool full) {
+			auto changed = _has_prev && (value != prev);
+			prev = value;
+			if (!full && !changed) {
+				return 0;
+			}
+			if (changed) {
+				_buffer += _use_color ? "\x1b[1;33m" : "*";
+			} else if (!_use_color) {
+				_buffer += ' ';
+			}
+			_buffer += name;
+			_buffer += ": ";
+			append_number(_buffer, value, 2, Architecture::WORD_SIZE);
+			_buffer += " (";
+			append_number(_buffer, value, 10, 2);
+			_buffer += ")";
+			if (changed && _use_color) {
+				_buffer += "\x1b[0m";
+			}
+			_buffer += '\n';
+			return changed ? 1 : 0;
+		}
+
+		static void append_number(string& str, size_t value, size_t base, size_t min_digits) {
+			const char* digits = "0123456789ABCDEF";
+			char buf[64];
+			size_t len = 0;
+			do {
+				buf[len++] = digits[value % base];
+				value /= base;
+			} while ((value > 0) && (len < sizeof(buf)));
+			while ((len < min_digits) && (len < sizeof(buf))) {
+				buf[len++] = '0';
+			}
+			while (len > 0) {
+				str += buf[--len];
+			}
+		}
+	};
 }